@@ -0,0 +1,97 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <cstdio>
+
+#include <QByteArray>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QStringList>
+
+#include "jpegfilefuzzer.h"
+
+// Upper bound on the reader operations used to parse an input of a given
+// size - every operation consumes at least one byte apart from the final
+// step of each search (which is preceded by a two-byte marker)
+static qint64 maxSteps(qint64 size)
+{
+    return 2 * size + 8;
+}
+
+/**
+ * Parse each file (or each file in each directory) given on the command line
+ * and check that the work done was proportional to its size. Files in a
+ * directory named "accept" must parse successfully and files in a directory
+ * named "reject" must fail; other files only need to be handled without
+ * error (which the sanitizers check).
+ */
+int main(int argc, char **argv)
+{
+    QStringList filenames;
+    for (int i = 1; i < argc; ++i) {
+        QString path = QFile::decodeName(argv[i]);
+        if (QFileInfo(path).isDir()) {
+            QDirIterator iterator(path, QDir::Files, QDirIterator::Subdirectories);
+            while (iterator.hasNext()) {
+                filenames.append(iterator.next());
+            }
+        } else {
+            filenames.append(path);
+        }
+    }
+
+    if (filenames.isEmpty()) {
+        fprintf(stderr, "no inputs to replay\n");
+        return 1;
+    }
+
+    int failed = 0;
+    foreach (const QString &filename, filenames) {
+        QFile file(filename);
+        if (!file.open(QIODevice::ReadOnly)) {
+            fprintf(stderr, "unable to read %s\n", qPrintable(filename));
+            return 1;
+        }
+        QByteArray data = file.readAll();
+
+        qint64 steps;
+        bool success = parseJpeg(data, steps);
+
+        if (steps > maxSteps(data.size())) {
+            fprintf(stderr, "%s: %lld steps for %d bytes\n", qPrintable(filename), steps, data.size());
+            ++failed;
+        }
+
+        QString expected = QFileInfo(filename).dir().dirName();
+        if ((expected == "accept" && !success) || (expected == "reject" && success)) {
+            fprintf(stderr, "%s: expected to %s\n", qPrintable(filename), qPrintable(expected));
+            ++failed;
+        }
+    }
+
+    printf("replayed %d inputs (%d failed)\n", filenames.count(), failed);
+    return failed ? 1 : 0;
+}
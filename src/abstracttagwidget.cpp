@@ -22,9 +22,8 @@
  * IN THE SOFTWARE.
  */
 
-#include <libexif/exif-content.h>
-
 #include "abstracttagwidget.h"
+#include "exifutils.h"
 
 AbstractTagWidget::AbstractTagWidget(ExifIfd ifd, const QString &name, QWidget *parent)
     : QWidget(parent),
@@ -45,11 +44,7 @@ void AbstractTagWidget::read(ExifData *data)
 
 void AbstractTagWidget::write(ExifData *data)
 {
-    ExifContent *content = data->ifd[mIfd];
-    ExifEntry *entry = exif_content_get_entry(content, mTag);
-    if (entry) {
-        exif_content_remove_entry(content, entry);
-    }
+    ExifUtils::removeEntry(data, mIfd, mTag);
     writeTag(data);
 }
 
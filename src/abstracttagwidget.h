@@ -37,7 +37,8 @@
  *
  * Each derived class must implement the two methods used for reading and
  * writing the tag value from an ExifData instance as well as one for
- * resetting the widget.
+ * resetting the widget. The changed() signal is emitted once the user has
+ * finished editing the value.
  */
 class AbstractTagWidget : public QWidget
 {
@@ -50,6 +51,11 @@ public:
     void read(ExifData *data);
     void write(ExifData *data);
 
+    ExifIfd ifd() const;
+    ExifTag tag() const;
+
+    virtual bool isModified() const = 0;
+
     virtual QSize sizeHint() const;
 
 signals:
@@ -62,9 +68,6 @@ protected:
     virtual void readTag(ExifEntry *entry) = 0;
     virtual void writeTag(ExifData *data) = 0;
 
-    ExifIfd ifd() const;
-    ExifTag tag() const;
-
 private:
 
     ExifIfd mIfd;
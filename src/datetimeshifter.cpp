@@ -0,0 +1,248 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <cstring>
+
+#include <QDateTime>
+#include <QFile>
+#include <QList>
+#include <QPair>
+#include <QtEndian>
+
+#include "datetimeshifter.h"
+#include "exifutils.h"
+#include "filelist.h"
+#include "jpegreader.h"
+#include "stats.h"
+
+// Length of a date and time in the EXIF format ("YYYY:MM:DD HH:MM:SS"),
+// excluding the terminating NUL
+const quint32 DateTimeLength = 19;
+
+// Size of the "Exif\0\0" identifier preceding the TIFF header
+const int ExifHeaderSize = 6;
+
+// Size of each entry in an IFD
+const quint32 IfdEntrySize = 12;
+
+const quint16 AsciiFormat = 2;
+const quint16 DateTimeTag = 0x0132;
+const quint16 ExifIfdPointerTag = 0x8769;
+const quint16 DateTimeOriginalTag = 0x9003;
+const quint16 DateTimeDigitizedTag = 0x9004;
+
+quint16 DateTimeShifter::Tiff::readQuint16(quint32 offset) const
+{
+    return littleEndian ?
+        qFromLittleEndian<quint16>(start + offset) :
+        qFromBigEndian<quint16>(start + offset);
+}
+
+quint32 DateTimeShifter::Tiff::readQuint32(quint32 offset) const
+{
+    return littleEndian ?
+        qFromLittleEndian<quint32>(start + offset) :
+        qFromBigEndian<quint32>(start + offset);
+}
+
+bool DateTimeShifter::parseOffset(const QString &value, qint64 &seconds)
+{
+    // Offsets are given as [+|-][[[days:]hours:]minutes:]seconds
+    QString offset = value.trimmed();
+    int sign = 1;
+    if (offset.startsWith('-') || offset.startsWith('+')) {
+        sign = offset.startsWith('-') ? -1 : 1;
+        offset.remove(0, 1);
+    }
+
+    QStringList parts = offset.split(':');
+    if (parts.count() > 4) {
+        return false;
+    }
+
+    const qint64 multipliers[] = { 1, 60, 60 * 60, 24 * 60 * 60 };
+    seconds = 0;
+    for (int i = 0; i < parts.count(); ++i) {
+        bool ok;
+        uint part = parts.at(parts.count() - 1 - i).toUInt(&ok);
+        if (!ok) {
+            return false;
+        }
+        seconds += part * multipliers[i];
+    }
+    seconds *= sign;
+
+    return true;
+}
+
+int DateTimeShifter::shift(const QStringList &filenames, qint64 seconds)
+{
+    return FileList::process(
+        filenames,
+        [seconds](const QString &filename, QString &) {
+            return shiftFile(filename, seconds);
+        },
+        "unable to shift dates in"
+    );
+}
+
+bool DateTimeShifter::shiftFile(const QString &filename, qint64 seconds)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadWrite)) {
+        return false;
+    }
+
+    // Load the EXIF segment (which is small) and locate the TIFF header
+    QByteArray segment;
+    qint64 segmentOffset;
+    if (!readExifSegment(file, segment, segmentOffset)) {
+        return false;
+    }
+
+    Tiff tiff;
+    tiff.start = reinterpret_cast<const uchar*>(segment.constData()) + ExifHeaderSize;
+    tiff.size = segment.length() - ExifHeaderSize;
+    if (tiff.size < 8) {
+        return false;
+    }
+    if (memcmp(tiff.start, "II", 2) == 0) {
+        tiff.littleEndian = true;
+    } else if (memcmp(tiff.start, "MM", 2) == 0) {
+        tiff.littleEndian = false;
+    } else {
+        return false;
+    }
+
+    // Find the values in IFD0 and the EXIF IFD
+    QList<quint32> valueOffsets;
+    quint32 exifIfdOffset = 0;
+    if (!findTags(tiff, tiff.readQuint32(4), QList<quint16>() << DateTimeTag, valueOffsets, &exifIfdOffset)) {
+        return false;
+    }
+    if (exifIfdOffset && !findTags(tiff, exifIfdOffset,
+            QList<quint16>() << DateTimeOriginalTag << DateTimeDigitizedTag, valueOffsets, nullptr)) {
+        return false;
+    }
+
+    // Compute every shifted value before writing any of them so that a value
+    // that cannot be shifted leaves the file untouched; dates are treated as
+    // UTC so that the shift is not affected by daylight saving time
+    // transitions
+    QList<QPair<quint32, QByteArray> > values;
+    foreach (quint32 valueOffset, valueOffsets) {
+        QString value = QString::fromLatin1(reinterpret_cast<const char*>(tiff.start + valueOffset), DateTimeLength);
+        QDate date = QDate::fromString(value.left(10), "yyyy:MM:dd");
+        QTime time = QTime::fromString(value.mid(11), "HH:mm:ss");
+        if (!date.isValid() || !time.isValid()) {
+            continue;
+        }
+
+        QDateTime dateTime(date, time, Qt::UTC);
+        QByteArray shifted = ExifUtils::formatDateTime(dateTime.addSecs(seconds)).toLatin1();
+        if (static_cast<quint32>(shifted.length()) != DateTimeLength) {
+            return false;
+        }
+        values.append(qMakePair(valueOffset, shifted));
+    }
+
+    // Overwrite each value in place
+    qint64 tiffOffset = segmentOffset + ExifHeaderSize;
+    for (auto i = values.constBegin(); i != values.constEnd(); ++i) {
+        if (!file.seek(tiffOffset + i->first) || file.write(i->second) != i->second.length()) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool DateTimeShifter::readExifSegment(QFile &file, QByteArray &segment, qint64 &offset)
+{
+    StatsTimer timer(Stats::Read);
+    JpegReader reader(&file);
+
+    // Only the segments preceding the image data need to be read
+    while (true) {
+        quint16 marker;
+        reader.skipFillBytes();
+        if (!reader.readQuint16(marker) || (marker & 0xff00) != 0xff00) {
+            return false;
+        }
+        if (marker == 0xffd8) {
+            continue;
+        }
+        if (marker == 0xffda || marker == 0xffd9) {
+            return false;
+        }
+
+        quint16 size;
+        if (!reader.readQuint16(size) || size < sizeof(quint16)) {
+            return false;
+        }
+        offset = reader.pos();
+        segment.clear();
+        if (!reader.read(segment, size - sizeof(quint16))) {
+            return false;
+        }
+
+        if (marker == 0xffe1 && segment.startsWith(QByteArray("Exif\0\0", ExifHeaderSize))) {
+            return true;
+        }
+    }
+}
+
+bool DateTimeShifter::findTags(const Tiff &tiff, quint32 ifdOffset, const QList<quint16> &tags,
+                               QList<quint32> &valueOffsets, quint32 *exifIfdOffset)
+{
+    if (tiff.size < sizeof(quint16) || ifdOffset > tiff.size - sizeof(quint16)) {
+        return false;
+    }
+    quint16 count = tiff.readQuint16(ifdOffset);
+    quint32 entries = ifdOffset + sizeof(quint16);
+    if (entries + static_cast<quint64>(count) * IfdEntrySize > tiff.size) {
+        return false;
+    }
+
+    for (quint16 i = 0; i < count; ++i) {
+        quint32 entry = entries + i * IfdEntrySize;
+        quint16 tag = tiff.readQuint16(entry);
+        quint16 format = tiff.readQuint16(entry + 2);
+        quint32 components = tiff.readQuint32(entry + 4);
+
+        if (tag == ExifIfdPointerTag && exifIfdOffset) {
+            *exifIfdOffset = tiff.readQuint32(entry + 8);
+        } else if (tags.contains(tag) && format == AsciiFormat && components >= DateTimeLength) {
+
+            // Values larger than four bytes are stored at the offset given
+            quint32 valueOffset = tiff.readQuint32(entry + 8);
+            if (static_cast<quint64>(valueOffset) + DateTimeLength > tiff.size) {
+                return false;
+            }
+            valueOffsets.append(valueOffset);
+        }
+    }
+
+    return true;
+}
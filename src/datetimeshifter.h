@@ -0,0 +1,67 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef DATETIMESHIFTER_H
+#define DATETIMESHIFTER_H
+
+#include <QByteArray>
+#include <QList>
+#include <QStringList>
+
+class QFile;
+
+/**
+ * @brief Shift the date and time tags of many files in place
+ *
+ * DateTime, DateTimeOriginal, and DateTimeDigitized are fixed-width ASCII
+ * values, so they can be located in the EXIF segment and overwritten
+ * directly in the file. This avoids decoding the EXIF data and rewriting the
+ * entire file for what is typically a change of a few bytes.
+ */
+class DateTimeShifter
+{
+public:
+
+    static bool parseOffset(const QString &value, qint64 &seconds);
+    static int shift(const QStringList &filenames, qint64 seconds);
+
+private:
+
+    struct Tiff
+    {
+        const uchar *start;
+        quint32 size;
+        bool littleEndian;
+
+        quint16 readQuint16(quint32 offset) const;
+        quint32 readQuint32(quint32 offset) const;
+    };
+
+    static bool shiftFile(const QString &filename, qint64 seconds);
+    static bool readExifSegment(QFile &file, QByteArray &segment, qint64 &offset);
+    static bool findTags(const Tiff &tiff, quint32 ifdOffset, const QList<quint16> &tags,
+                         QList<quint32> &valueOffsets, quint32 *exifIfdOffset);
+};
+
+#endif // DATETIMESHIFTER_H
@@ -0,0 +1,483 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <cstring>
+
+#include <libexif/exif-content.h>
+#include <libexif/exif-entry.h>
+#include <libexif/exif-format.h>
+#include <libexif/exif-mem.h>
+#include <libexif/exif-utils.h>
+
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QStringList>
+
+#include "exifutils.h"
+
+// Formats of the non-text tags that libexif cannot create a default value
+// for; tags that cannot be set from text are included so that they are not
+// mistaken for text
+const struct {
+    ExifTag tag;
+    ExifFormat format;
+} TagFormats[] = {
+    { EXIF_TAG_EXPOSURE_TIME, EXIF_FORMAT_RATIONAL },
+    { EXIF_TAG_FNUMBER, EXIF_FORMAT_RATIONAL },
+    { EXIF_TAG_EXPOSURE_PROGRAM, EXIF_FORMAT_SHORT },
+    { EXIF_TAG_ISO_SPEED_RATINGS, EXIF_FORMAT_SHORT },
+    { EXIF_TAG_SHUTTER_SPEED_VALUE, EXIF_FORMAT_SRATIONAL },
+    { EXIF_TAG_APERTURE_VALUE, EXIF_FORMAT_RATIONAL },
+    { EXIF_TAG_BRIGHTNESS_VALUE, EXIF_FORMAT_SRATIONAL },
+    { EXIF_TAG_EXPOSURE_BIAS_VALUE, EXIF_FORMAT_SRATIONAL },
+    { EXIF_TAG_MAX_APERTURE_VALUE, EXIF_FORMAT_RATIONAL },
+    { EXIF_TAG_SUBJECT_DISTANCE, EXIF_FORMAT_RATIONAL },
+    { EXIF_TAG_METERING_MODE, EXIF_FORMAT_SHORT },
+    { EXIF_TAG_LIGHT_SOURCE, EXIF_FORMAT_SHORT },
+    { EXIF_TAG_FLASH, EXIF_FORMAT_SHORT },
+    { EXIF_TAG_FOCAL_LENGTH, EXIF_FORMAT_RATIONAL },
+    { EXIF_TAG_FOCAL_LENGTH_IN_35MM_FILM, EXIF_FORMAT_SHORT },
+    { EXIF_TAG_EXPOSURE_MODE, EXIF_FORMAT_SHORT },
+    { EXIF_TAG_WHITE_BALANCE, EXIF_FORMAT_SHORT },
+    { EXIF_TAG_DIGITAL_ZOOM_RATIO, EXIF_FORMAT_RATIONAL },
+    { EXIF_TAG_SCENE_CAPTURE_TYPE, EXIF_FORMAT_SHORT },
+    { EXIF_TAG_GAIN_CONTROL, EXIF_FORMAT_SHORT },
+    { EXIF_TAG_CONTRAST, EXIF_FORMAT_SHORT },
+    { EXIF_TAG_SATURATION, EXIF_FORMAT_SHORT },
+    { EXIF_TAG_SHARPNESS, EXIF_FORMAT_SHORT },
+    { EXIF_TAG_SUBJECT_DISTANCE_RANGE, EXIF_FORMAT_SHORT },
+    { EXIF_TAG_PIXEL_X_DIMENSION, EXIF_FORMAT_LONG },
+    { EXIF_TAG_PIXEL_Y_DIMENSION, EXIF_FORMAT_LONG },
+    { EXIF_TAG_MAKER_NOTE, EXIF_FORMAT_UNDEFINED },
+    { EXIF_TAG_FILE_SOURCE, EXIF_FORMAT_UNDEFINED },
+    { EXIF_TAG_SCENE_TYPE, EXIF_FORMAT_UNDEFINED },
+    { EXIF_TAG_CFA_PATTERN, EXIF_FORMAT_UNDEFINED },
+    { EXIF_TAG_OECF, EXIF_FORMAT_UNDEFINED },
+    { EXIF_TAG_SPATIAL_FREQUENCY_RESPONSE, EXIF_FORMAT_UNDEFINED },
+    { EXIF_TAG_DEVICE_SETTING_DESCRIPTION, EXIF_FORMAT_UNDEFINED },
+    { EXIF_TAG_XP_TITLE, EXIF_FORMAT_BYTE },
+    { EXIF_TAG_XP_COMMENT, EXIF_FORMAT_BYTE },
+    { EXIF_TAG_XP_AUTHOR, EXIF_FORMAT_BYTE },
+    { EXIF_TAG_XP_KEYWORDS, EXIF_FORMAT_BYTE },
+    { EXIF_TAG_XP_SUBJECT, EXIF_FORMAT_BYTE },
+    { EXIF_TAG_GPS_VERSION_ID, EXIF_FORMAT_BYTE },
+    { EXIF_TAG_GPS_LATITUDE, EXIF_FORMAT_RATIONAL },
+    { EXIF_TAG_GPS_LONGITUDE, EXIF_FORMAT_RATIONAL },
+    { EXIF_TAG_GPS_ALTITUDE_REF, EXIF_FORMAT_BYTE },
+    { EXIF_TAG_GPS_ALTITUDE, EXIF_FORMAT_RATIONAL },
+    { EXIF_TAG_GPS_TIME_STAMP, EXIF_FORMAT_RATIONAL },
+    { EXIF_TAG_GPS_DOP, EXIF_FORMAT_RATIONAL },
+    { EXIF_TAG_GPS_SPEED, EXIF_FORMAT_RATIONAL },
+    { EXIF_TAG_GPS_TRACK, EXIF_FORMAT_RATIONAL },
+    { EXIF_TAG_GPS_IMG_DIRECTION, EXIF_FORMAT_RATIONAL },
+    { EXIF_TAG_GPS_DEST_LATITUDE, EXIF_FORMAT_RATIONAL },
+    { EXIF_TAG_GPS_DEST_LONGITUDE, EXIF_FORMAT_RATIONAL },
+    { EXIF_TAG_GPS_DEST_BEARING, EXIF_FORMAT_RATIONAL },
+    { EXIF_TAG_GPS_DEST_DISTANCE, EXIF_FORMAT_RATIONAL },
+    { EXIF_TAG_GPS_PROCESSING_METHOD, EXIF_FORMAT_UNDEFINED },
+    { EXIF_TAG_GPS_AREA_INFORMATION, EXIF_FORMAT_UNDEFINED },
+    { EXIF_TAG_GPS_DIFFERENTIAL, EXIF_FORMAT_SHORT }
+};
+
+// Format of each (IFD, tag) pair looked up so far, or zero if unknown
+static QMutex gFormatMutex;
+static QHash<quint32, int> gFormats;
+
+TagValue::TagValue()
+    : present(false),
+      format(EXIF_FORMAT_UNDEFINED),
+      components(0)
+{
+}
+
+bool TagValue::operator==(const TagValue &other) const
+{
+    return present == other.present &&
+            format == other.format &&
+            components == other.components &&
+            bytes == other.bytes;
+}
+
+bool TagValue::operator!=(const TagValue &other) const
+{
+    return !(*this == other);
+}
+
+static int findFormat(ExifIfd ifd, ExifTag tag)
+{
+    // libexif records the format of each tag it can create a default value
+    // for, so initialize an entry in a scratch instance and inspect it
+    int format = 0;
+    ExifData *data = exif_data_new();
+    if (!data) {
+        return 0;
+    }
+    ExifEntry *entry = exif_entry_new();
+    if (entry) {
+        exif_content_add_entry(data->ifd[ifd], entry);
+        exif_entry_initialize(entry, tag);
+        format = entry->format;
+        exif_entry_unref(entry);
+    }
+    exif_data_unref(data);
+    if (format) {
+        return format;
+    }
+
+    // Fall back to the table for tags without a default value
+    for (const auto &t : TagFormats) {
+        if (t.tag == tag) {
+            return t.format;
+        }
+    }
+
+    // The remaining tags known to libexif are text (LensModel,
+    // ImageUniqueID, SubSecTimeOriginal, etc.)
+    return exif_tag_get_name_in_ifd(tag, ifd) ? EXIF_FORMAT_ASCII : 0;
+}
+
+QList<ExifIfd> ExifUtils::ifds()
+{
+    // IFDs in the order that tags are most commonly found, which puts the
+    // main image (IFD0) ahead of the thumbnail (IFD1)
+    return QList<ExifIfd>()
+        << EXIF_IFD_0
+        << EXIF_IFD_EXIF
+        << EXIF_IFD_GPS
+        << EXIF_IFD_INTEROPERABILITY
+        << EXIF_IFD_1;
+}
+
+bool ExifUtils::findTag(const QString &name, ExifIfd &ifd, ExifTag &tag)
+{
+    QByteArray utf8Name = name.toUtf8();
+    ExifTag t = exif_tag_from_name(utf8Name.constData());
+
+    // A tag value of zero is also returned for unknown names, so confirm that
+    // the name is actually recorded in one of the IFDs
+    foreach (ExifIfd i, ifds()) {
+        const char *ifdName = exif_tag_get_name_in_ifd(t, i);
+        if (ifdName && utf8Name == ifdName) {
+            ifd = i;
+            tag = t;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool ExifUtils::tagFormat(ExifIfd ifd, ExifTag tag, ExifFormat &format)
+{
+    // Formats never change, so each tag is only looked up once
+    quint32 key = (static_cast<quint32>(ifd) << 16) | tag;
+    int found;
+    {
+        QMutexLocker locker(&gFormatMutex);
+        auto i = gFormats.constFind(key);
+        if (i != gFormats.constEnd()) {
+            found = i.value();
+        } else {
+            found = findFormat(ifd, tag);
+            gFormats.insert(key, found);
+        }
+    }
+
+    if (!found) {
+        return false;
+    }
+    format = static_cast<ExifFormat>(found);
+    return true;
+}
+
+bool ExifUtils::fromString(ExifIfd ifd, ExifTag tag, const QString &value, ExifByteOrder order, TagValue &result)
+{
+    ExifFormat format;
+    if (!tagFormat(ifd, tag, format)) {
+        return false;
+    }
+
+    result = TagValue();
+    result.present = true;
+    result.format = format;
+
+    if (format == EXIF_FORMAT_ASCII) {
+        result.bytes = value.toUtf8();
+        result.components = result.bytes.length();
+        return true;
+    }
+
+    // Numeric values are separated by whitespace or commas
+    QString simplified = QString(value).replace(',', ' ').simplified();
+    if (simplified.isEmpty()) {
+        return false;
+    }
+    QStringList parts = simplified.split(' ');
+
+    unsigned int size = exif_format_get_size(format);
+    result.bytes = QByteArray(size * parts.count(), 0);
+    result.components = parts.count();
+
+    for (int i = 0; i < parts.count(); ++i) {
+        unsigned char *p = reinterpret_cast<unsigned char*>(result.bytes.data()) + i * size;
+        const QString &part = parts.at(i);
+        bool ok = false;
+
+        switch (format) {
+        case EXIF_FORMAT_SHORT:
+            exif_set_short(p, order, part.toUShort(&ok));
+            break;
+        case EXIF_FORMAT_SSHORT:
+            exif_set_sshort(p, order, part.toShort(&ok));
+            break;
+        case EXIF_FORMAT_LONG:
+            exif_set_long(p, order, part.toUInt(&ok));
+            break;
+        case EXIF_FORMAT_SLONG:
+            exif_set_slong(p, order, part.toInt(&ok));
+            break;
+        case EXIF_FORMAT_RATIONAL:
+        {
+            qint64 numerator, denominator;
+            ok = parseRational(part, numerator, denominator) &&
+                    numerator >= 0 && numerator <= 0xffffffffLL;
+            ExifRational rational = {
+                static_cast<ExifLong>(numerator),
+                static_cast<ExifLong>(denominator)
+            };
+            exif_set_rational(p, order, rational);
+            break;
+        }
+        case EXIF_FORMAT_SRATIONAL:
+        {
+            qint64 numerator, denominator;
+            ok = parseRational(part, numerator, denominator) &&
+                    numerator >= -0x80000000LL && numerator <= 0x7fffffffLL &&
+                    denominator <= 0x7fffffffLL;
+            ExifSRational rational = {
+                static_cast<ExifSLong>(numerator),
+                static_cast<ExifSLong>(denominator)
+            };
+            exif_set_srational(p, order, rational);
+            break;
+        }
+        default:
+            // Byte, undefined, and floating point values cannot be set from
+            // text
+            break;
+        }
+
+        if (!ok) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool ExifUtils::parseRational(const QString &value, qint64 &numerator, qint64 &denominator)
+{
+    bool ok;
+
+    // Explicit fractions are used as-is
+    int slash = value.indexOf('/');
+    if (slash != -1) {
+        bool denominatorOk;
+        numerator = value.left(slash).toLongLong(&ok);
+        denominator = value.mid(slash + 1).toLongLong(&denominatorOk);
+        return ok && denominatorOk && denominator > 0 && denominator <= 0xffffffffLL;
+    }
+
+    // Decimals are scaled by a power of ten until they are whole (or the
+    // precision of the denominator is exhausted)
+    double number = value.toDouble(&ok);
+    if (!ok) {
+        return false;
+    }
+    denominator = 1;
+    while (number != static_cast<qint64>(number) && denominator < 1000000) {
+        number *= 10;
+        denominator *= 10;
+    }
+    if (number < -0x80000000LL || number > 0xffffffffLL) {
+        return false;
+    }
+    numerator = qRound64(number);
+    return true;
+}
+
+QString ExifUtils::stringValue(ExifData *data, ExifIfd ifd, ExifTag tag)
+{
+    ExifEntry *entry = exif_content_get_entry(data->ifd[ifd], tag);
+    if (!entry) {
+        return QString();
+    }
+    char value[256];
+    exif_entry_get_value(entry, value, sizeof(value) / sizeof(char));
+    return QString::fromUtf8(value);
+}
+
+bool ExifUtils::setStringValue(ExifData *data, ExifIfd ifd, ExifTag tag, const QByteArray &value)
+{
+    TagValue tagValue;
+    if (!fromString(ifd, tag, QString::fromUtf8(value), exif_data_get_byte_order(data), tagValue)) {
+        return false;
+    }
+    return setTagValue(data, ifd, tag, tagValue);
+}
+
+bool ExifUtils::setShortValue(ExifData *data, ExifIfd ifd, ExifTag tag, quint16 value)
+{
+    QByteArray buffer(exif_format_get_size(EXIF_FORMAT_SHORT), 0);
+    exif_set_short(
+        reinterpret_cast<unsigned char*>(buffer.data()),
+        exif_data_get_byte_order(data),
+        value
+    );
+    return setValue(data, ifd, tag, EXIF_FORMAT_SHORT, 1, buffer);
+}
+
+bool ExifUtils::setValue(ExifData *data, ExifIfd ifd, ExifTag tag, ExifFormat format,
+                         unsigned long components, const QByteArray &value)
+{
+    ExifMem *mem = nullptr;
+    ExifEntry *entry = nullptr;
+    bool success = false;
+
+    // Remove the existing entry (if any)
+    removeEntry(data, ifd, tag);
+
+    do {
+
+        // Create a memory allocator
+        mem = exif_mem_new_default();
+        if (!mem) {
+            break;
+        }
+
+        // Create a new entry
+        entry = exif_entry_new_mem(mem);
+        if (!entry) {
+            break;
+        }
+
+        // Allocate memory and copy data to the buffer (empty values, such as
+        // a blank string, are stored as an entry without data)
+        void *buffer = nullptr;
+        if (!value.isEmpty()) {
+            buffer = exif_mem_alloc(mem, value.length());
+            if (!buffer) {
+                break;
+            }
+            memcpy(buffer, value.constData(), value.length());
+        }
+
+        // Initialize the entry
+        entry->tag = tag;
+        entry->format = format;
+        entry->components = components;
+        entry->data = reinterpret_cast<unsigned char*>(buffer);
+        entry->size = value.length();
+
+        // Add the entry to the correct IFD
+        exif_content_add_entry(data->ifd[ifd], entry);
+        success = true;
+
+    } while (false);
+
+    // Unref the entry and allocator if non-null
+    if (entry) {
+        exif_entry_unref(entry);
+    }
+    if (mem) {
+        exif_mem_unref(mem);
+    }
+
+    return success;
+}
+
+void ExifUtils::removeEntry(ExifData *data, ExifIfd ifd, ExifTag tag)
+{
+    ExifContent *content = data->ifd[ifd];
+    ExifEntry *entry = exif_content_get_entry(content, tag);
+    if (entry) {
+        exif_content_remove_entry(content, entry);
+    }
+}
+
+TagValue ExifUtils::tagValue(ExifData *data, ExifIfd ifd, ExifTag tag)
+{
+    TagValue value;
+    ExifEntry *entry = exif_content_get_entry(data->ifd[ifd], tag);
+    if (entry) {
+        value.present = true;
+        value.format = entry->format;
+        value.components = entry->components;
+        value.bytes = QByteArray(reinterpret_cast<const char*>(entry->data), entry->size);
+    }
+    return value;
+}
+
+bool ExifUtils::setTagValue(ExifData *data, ExifIfd ifd, ExifTag tag, const TagValue &value)
+{
+    if (!value.present) {
+        removeEntry(data, ifd, tag);
+        return true;
+    }
+    return setValue(data, ifd, tag, value.format, value.components, value.bytes);
+}
+
+QDateTime ExifUtils::parseDateTime(const QString &value)
+{
+    // The EXIF format is tried first, followed by formats commonly written by
+    // other software
+    const char *const formats[] = {
+        "yyyy:MM:dd HH:mm:ss",
+        "yyyy-MM-dd HH:mm:ss",
+        "yyyy/MM/dd HH:mm:ss",
+        "yyyy:MM:ddTHH:mm:ss",
+        "yyyy-MM-ddTHH:mm:ss"
+    };
+    QString trimmed = value.trimmed();
+    for (const char *format : formats) {
+        QDateTime dateTime = QDateTime::fromString(trimmed, format);
+        if (dateTime.isValid()) {
+            return dateTime;
+        }
+    }
+
+    // Fall back to ISO 8601 (which may include a time zone that cannot be
+    // represented and is dropped)
+    QDateTime dateTime = QDateTime::fromString(trimmed, Qt::ISODate);
+    if (dateTime.isValid()) {
+        dateTime = QDateTime(dateTime.date(), dateTime.time());
+    }
+    return dateTime;
+}
+
+QString ExifUtils::formatDateTime(const QDateTime &dateTime)
+{
+    return dateTime.toString("yyyy:MM:dd HH:mm:ss");
+}
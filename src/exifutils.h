@@ -0,0 +1,93 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef EXIFUTILS_H
+#define EXIFUTILS_H
+
+#include <libexif/exif-data.h>
+#include <libexif/exif-format.h>
+#include <libexif/exif-ifd.h>
+#include <libexif/exif-tag.h>
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QList>
+#include <QString>
+
+/**
+ * @brief Raw value of a single tag
+ *
+ * Only the bytes of the entry are stored, which keeps copies cheap compared
+ * to duplicating the entire ExifData instance.
+ */
+struct TagValue
+{
+    TagValue();
+
+    bool operator==(const TagValue &other) const;
+    bool operator!=(const TagValue &other) const;
+
+    bool present;
+    ExifFormat format;
+    unsigned long components;
+    QByteArray bytes;
+};
+
+/**
+ * @brief Helper methods for manipulating tags outside of the UI
+ *
+ * Tags are addressed by (IFD, tag) pairs in the same way as AbstractTagWidget
+ * so that headless commands and the widgets share a single implementation.
+ * String values are converted to the tag's native format (as known to
+ * libexif), so numeric tags such as Orientation can be set from text.
+ */
+class ExifUtils
+{
+public:
+
+    static QList<ExifIfd> ifds();
+    static bool findTag(const QString &name, ExifIfd &ifd, ExifTag &tag);
+
+    static bool tagFormat(ExifIfd ifd, ExifTag tag, ExifFormat &format);
+    static bool fromString(ExifIfd ifd, ExifTag tag, const QString &value, ExifByteOrder order, TagValue &result);
+
+    static QString stringValue(ExifData *data, ExifIfd ifd, ExifTag tag);
+    static bool setStringValue(ExifData *data, ExifIfd ifd, ExifTag tag, const QByteArray &value);
+    static bool setShortValue(ExifData *data, ExifIfd ifd, ExifTag tag, quint16 value);
+    static bool setValue(ExifData *data, ExifIfd ifd, ExifTag tag, ExifFormat format,
+                         unsigned long components, const QByteArray &value);
+    static void removeEntry(ExifData *data, ExifIfd ifd, ExifTag tag);
+
+    static TagValue tagValue(ExifData *data, ExifIfd ifd, ExifTag tag);
+    static bool setTagValue(ExifData *data, ExifIfd ifd, ExifTag tag, const TagValue &value);
+
+    static QDateTime parseDateTime(const QString &value);
+    static QString formatDateTime(const QDateTime &dateTime);
+
+private:
+
+    static bool parseRational(const QString &value, qint64 &numerator, qint64 &denominator);
+};
+
+#endif // EXIFUTILS_H
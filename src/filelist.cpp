@@ -0,0 +1,107 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <cstdio>
+
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QList>
+#include <QSet>
+#include <QtConcurrent>
+
+#include "filelist.h"
+
+QStringList FileList::expand(const QStringList &paths)
+{
+    QStringList filenames;
+    QSet<QString> canonicalFilenames;
+    foreach (const QString &path, paths) {
+        if (QFileInfo(path).isDir()) {
+            QDirIterator iterator(
+                path,
+                QStringList() << "*.jpg" << "*.jpeg" << "*.JPG" << "*.JPEG",
+                QDir::Files,
+                QDirIterator::Subdirectories
+            );
+            while (iterator.hasNext()) {
+                append(filenames, canonicalFilenames, iterator.next());
+            }
+        } else {
+            append(filenames, canonicalFilenames, path);
+        }
+    }
+    return filenames;
+}
+
+void FileList::append(QStringList &filenames, QSet<QString> &canonicalFilenames, const QString &filename)
+{
+    // Overlapping paths and symlinks can name the same file more than once,
+    // which would have it processed twice (concurrently) - files that don't
+    // exist have no canonical path and are kept so that they are reported
+    QString canonicalFilename = QFileInfo(filename).canonicalFilePath();
+    if (!canonicalFilename.isEmpty()) {
+        if (canonicalFilenames.contains(canonicalFilename)) {
+            return;
+        }
+        canonicalFilenames.insert(canonicalFilename);
+    }
+    filenames.append(filename);
+}
+
+int FileList::process(const QStringList &filenames, const Function &function, const char *failureMessage)
+{
+    struct Job
+    {
+        QString filename;
+        QString output;
+        bool success;
+    };
+
+    QList<Job> jobs;
+    foreach (const QString &filename, filenames) {
+        Job job;
+        job.filename = filename;
+        job.success = false;
+        jobs.append(job);
+    }
+
+    // Process the files in parallel
+    QtConcurrent::blockingMap(jobs, [&function](Job &job) {
+        job.success = function(job.filename, job.output);
+    });
+
+    // Print any output in the order the files were supplied and report the
+    // files that could not be processed
+    int failed = 0;
+    foreach (const Job &job, jobs) {
+        if (job.success) {
+            fputs(qPrintable(job.output), stdout);
+        } else {
+            qWarning("%s %s", failureMessage, qPrintable(job.filename));
+            ++failed;
+        }
+    }
+
+    return failed;
+}
@@ -0,0 +1,55 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef FILELIST_H
+#define FILELIST_H
+
+#include <functional>
+
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+/**
+ * @brief Expand and process the paths supplied to batch commands
+ *
+ * Files are used as-is while directories are searched recursively for JPEG
+ * images. A file named more than once (by overlapping paths or through a
+ * symlink) is only included the first time.
+ */
+class FileList
+{
+public:
+
+    typedef std::function<bool(const QString &filename, QString &output)> Function;
+
+    static QStringList expand(const QStringList &paths);
+    static int process(const QStringList &filenames, const Function &function, const char *failureMessage);
+
+private:
+
+    static void append(QStringList &filenames, QSet<QString> &canonicalFilenames, const QString &filename);
+};
+
+#endif // FILELIST_H
@@ -0,0 +1,249 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSocketNotifier>
+#include <QThread>
+#include <QtConcurrent>
+
+#include "exifutils.h"
+#include "folderwatcher.h"
+#include "jpegfile.h"
+
+// Tags updated when normalizing dates
+const struct {
+    ExifIfd ifd;
+    ExifTag tag;
+} DateTimeTags[] = {
+    { EXIF_IFD_0, EXIF_TAG_DATE_TIME },
+    { EXIF_IFD_EXIF, EXIF_TAG_DATE_TIME_ORIGINAL },
+    { EXIF_IFD_EXIF, EXIF_TAG_DATE_TIME_DIGITIZED }
+};
+
+FolderWatcher::FolderWatcher(QObject *parent)
+    : QObject(parent),
+      mFd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)),
+      mNotifier(nullptr)
+{
+    if (mFd != -1) {
+        mNotifier = new QSocketNotifier(mFd, QSocketNotifier::Read, this);
+        connect(mNotifier, &QSocketNotifier::activated, this, &FolderWatcher::onActivated);
+    }
+
+    mTimer.setSingleShot(true);
+    connect(&mTimer, &QTimer::timeout, this, &FolderWatcher::onTimeout);
+}
+
+FolderWatcher::~FolderWatcher()
+{
+    mPool.waitForDone();
+    if (mFd != -1) {
+        close(mFd);
+    }
+}
+
+bool FolderWatcher::load(const QString &filename)
+{
+    if (mFd == -1) {
+        return false;
+    }
+
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QJsonDocument document = QJsonDocument::fromJson(file.readAll());
+    if (!document.isObject()) {
+        qWarning("%s: expected an object", qPrintable(filename));
+        return false;
+    }
+    QJsonObject config = document.object();
+
+    mTimer.setInterval(config.value("delay").toInt(500));
+    mPool.setMaxThreadCount(config.value("workers").toInt(QThread::idealThreadCount()));
+
+    foreach (const QJsonValue &value, config.value("rules").toArray()) {
+        QJsonObject object = value.toObject();
+
+        Rule rule;
+        rule.path = object.value("path").toString();
+        rule.normalizeDateTime = object.value("normalizeDateTime").toBool();
+
+        QJsonObject tags = object.value("tags").toObject();
+        for (auto i = tags.constBegin(); i != tags.constEnd(); ++i) {
+            Edit edit;
+            if (!ExifUtils::findTag(i.key(), edit.ifd, edit.tag)) {
+                qWarning("%s: unknown tag \"%s\"", qPrintable(filename), qPrintable(i.key()));
+                return false;
+            }
+            TagValue tagValue;
+            if (!i.value().isString() ||
+                    !ExifUtils::fromString(edit.ifd, edit.tag, i.value().toString(), EXIF_BYTE_ORDER_MOTOROLA, tagValue)) {
+                qWarning("%s: invalid value for \"%s\"", qPrintable(filename), qPrintable(i.key()));
+                return false;
+            }
+            edit.value = i.value().toString();
+            rule.edits.append(edit);
+        }
+
+        // Watch for files that are closed after writing or moved into place
+        int wd = inotify_add_watch(mFd, QFile::encodeName(rule.path).constData(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (wd == -1) {
+            qWarning("unable to watch %s", qPrintable(rule.path));
+            return false;
+        }
+        mWatches.insert(wd, mRules.count());
+        mRules.append(rule);
+    }
+
+    return true;
+}
+
+void FolderWatcher::onActivated()
+{
+    alignas(inotify_event) char buffer[4096];
+
+    while (true) {
+        ssize_t length = read(mFd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            break;
+        }
+
+        for (char *p = buffer; p < buffer + length; ) {
+            const inotify_event *event = reinterpret_cast<const inotify_event*>(p);
+            p += sizeof(inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                qWarning("inotify queue overflowed; some files may not have been processed");
+                continue;
+            }
+            if (!event->len || !mWatches.contains(event->wd)) {
+                continue;
+            }
+
+            QString name = QFile::decodeName(event->name);
+            QString suffix = QFileInfo(name).suffix().toLower();
+            if (suffix != "jpg" && suffix != "jpeg") {
+                continue;
+            }
+
+            int rule = mWatches.value(event->wd);
+            mPending.insert(QDir(mRules.at(rule).path).absoluteFilePath(name), rule);
+        }
+    }
+
+    // Wait for the burst of events to end before processing the files
+    if (!mPending.isEmpty()) {
+        mTimer.start();
+    }
+}
+
+void FolderWatcher::onTimeout()
+{
+    // Files still being processed remain pending until their job finishes
+    for (auto i = mPending.begin(); i != mPending.end(); ) {
+        if (mActive.contains(i.key())) {
+            ++i;
+        } else {
+            start(i.key(), i.value());
+            i = mPending.erase(i);
+        }
+    }
+}
+
+void FolderWatcher::start(const QString &filename, int rule)
+{
+    mActive.insert(filename);
+
+    QFutureWatcher<bool> *watcher = new QFutureWatcher<bool>(this);
+    connect(watcher, &QFutureWatcher<bool>::finished, this, [this, watcher, filename]() {
+        if (!watcher->result()) {
+            qWarning("unable to update %s", qPrintable(filename));
+        }
+        watcher->deleteLater();
+
+        mActive.remove(filename);
+        if (!mPending.isEmpty() && !mTimer.isActive()) {
+            mTimer.start();
+        }
+    });
+    watcher->setFuture(QtConcurrent::run(&mPool, &FolderWatcher::applyRule, filename, mRules.at(rule)));
+}
+
+bool FolderWatcher::applyRule(const QString &filename, const Rule &rule)
+{
+    JpegFile file(filename);
+    if (!file.open()) {
+        return false;
+    }
+
+    ExifData *data = file.data();
+    bool changed = false;
+
+    foreach (const Edit &edit, rule.edits) {
+        // Compare raw values since the display form of numeric tags (such as
+        // "Top-left" for Orientation) differs from the rule's value
+        TagValue value;
+        if (!ExifUtils::fromString(edit.ifd, edit.tag, edit.value, exif_data_get_byte_order(data), value)) {
+            return false;
+        }
+        if (ExifUtils::tagValue(data, edit.ifd, edit.tag) != value) {
+            if (!ExifUtils::setTagValue(data, edit.ifd, edit.tag, value)) {
+                return false;
+            }
+            changed = true;
+        }
+    }
+
+    if (rule.normalizeDateTime) {
+        for (const auto &t : DateTimeTags) {
+            QString value = ExifUtils::stringValue(data, t.ifd, t.tag);
+            QDateTime dateTime = ExifUtils::parseDateTime(value);
+            if (!dateTime.isValid()) {
+                continue;
+            }
+            QString normalized = ExifUtils::formatDateTime(dateTime);
+            if (normalized != value) {
+                if (!ExifUtils::setStringValue(data, t.ifd, t.tag, normalized.toUtf8())) {
+                    return false;
+                }
+                changed = true;
+            }
+        }
+    }
+
+    // Files that already match the rule are left alone, which also prevents
+    // the watcher from reacting to its own writes indefinitely
+    return changed ? file.save() : true;
+}
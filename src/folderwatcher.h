@@ -0,0 +1,108 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef FOLDERWATCHER_H
+#define FOLDERWATCHER_H
+
+#include <libexif/exif-ifd.h>
+#include <libexif/exif-tag.h>
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QThreadPool>
+#include <QTimer>
+
+class QSocketNotifier;
+
+/**
+ * @brief Apply tag rules to JPEG files as they are written to ingest folders
+ *
+ * Rules are loaded from a JSON file of the form:
+ *
+ *     {
+ *         "workers": 4,
+ *         "delay": 500,
+ *         "rules": [
+ *             {"path": "/ingest/camera1", "tags": {"Make": "Canon"}, "normalizeDateTime": true}
+ *         ]
+ *     }
+ *
+ * inotify reports files once they have been closed after writing (or moved
+ * into the folder). Events are coalesced for "delay" milliseconds and the
+ * files are then processed by a pool of "workers" threads. Files are only
+ * saved if a rule changes them, so the watcher's own writes do not trigger
+ * further saves.
+ */
+class FolderWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    explicit FolderWatcher(QObject *parent = nullptr);
+    virtual ~FolderWatcher();
+
+    bool load(const QString &filename);
+
+private slots:
+
+    void onActivated();
+    void onTimeout();
+
+private:
+
+    struct Edit
+    {
+        ExifIfd ifd;
+        ExifTag tag;
+        QString value;
+    };
+
+    struct Rule
+    {
+        QString path;
+        QList<Edit> edits;
+        bool normalizeDateTime;
+    };
+
+    void start(const QString &filename, int rule);
+
+    static bool applyRule(const QString &filename, const Rule &rule);
+
+    int mFd;
+    QSocketNotifier *mNotifier;
+
+    QList<Rule> mRules;
+    QHash<int, int> mWatches;
+
+    QTimer mTimer;
+    QThreadPool mPool;
+    QHash<QString, int> mPending;
+    QSet<QString> mActive;
+};
+
+#endif // FOLDERWATCHER_H
@@ -0,0 +1,50 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "filelist.h"
+#include "imagehasher.h"
+#include "jpegfile.h"
+#include "stats.h"
+
+int ImageHasher::hash(const QStringList &filenames)
+{
+    // Hashes are printed in the order the files were supplied
+    return FileList::process(filenames, &ImageHasher::hashFile, "unable to read");
+}
+
+bool ImageHasher::hashFile(const QString &filename, QString &output)
+{
+    StatsTimer timer(Stats::Hash);
+
+    // The image data is hashed while the file is parsed, so each file is
+    // only read once
+    JpegFile file(filename);
+    file.setHashImageData(true);
+    if (!file.open()) {
+        return false;
+    }
+    QByteArray hash = file.imageHash();
+    output = QString("%1  %2\n").arg(QString::fromLatin1(hash.toHex())).arg(filename);
+    return true;
+}
@@ -22,13 +22,33 @@
  * IN THE SOFTWARE.
  */
 
+#include <cstdlib>
+#include <cstring>
+
+#include <QCryptographicHash>
 #include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QScopedPointer>
 #include <QtEndian>
 
 #include "jpegfile.h"
+#include "jpegreader.h"
+#include "stats.h"
+
+// Size of the buffer used when copying image data between files
+const qint64 CopyChunkSize = 64 * 1024;
+
+// Largest payload that fits in a segment (the 16-bit size includes the two
+// bytes used to store it)
+const unsigned int MaxSegmentSize = 0xffff - sizeof(quint16);
 
 JpegFile::JpegFile(const QString &filename)
     : mFilename(filename),
+      mSourceFilename(filename),
+      mSize(0),
+      mParseSteps(0),
+      mHashImageData(false),
       mData(nullptr)
 {
 }
@@ -42,34 +62,102 @@ JpegFile::~JpegFile()
 
 bool JpegFile::open()
 {
-    // Open the file for reading
-    QFile file(mFilename);
+    // Reading is interleaved with parsing, so the read phase covers the
+    // entire file (and includes the parse phase)
+    StatsTimer timer(Stats::Read);
+
+    QFile file(mSourceFilename);
     if (!file.open(QIODevice::ReadOnly)) {
+        Stats::fileOpened(0, false);
         return false;
     }
 
-    // Alocate a buffer the size of the file and read it in
-    QByteArray buffer = file.readAll();
-    file.close();
+    // Note the modification time before reading so that changes made while
+    // parsing are also detected
+    mModified = QFileInfo(file).lastModified();
+    return open(&file);
+}
 
-    // Ensure the entire file was read
-    if (buffer.length() != file.size()) {
-        return false;
+bool JpegFile::open(QIODevice *device)
+{
+    bool success = parse(device);
+    Stats::fileOpened(mSize, success);
+    return success;
+}
+
+bool JpegFile::save()
+{
+    qint64 bytesWritten = 0;
+    bool success = write(bytesWritten);
+    Stats::fileSaved(bytesWritten, success);
+    return success;
+}
+
+QString JpegFile::filename() const
+{
+    return mFilename;
+}
+
+void JpegFile::setFilename(const QString &filename)
+{
+    mFilename = filename;
+}
+
+ExifData *JpegFile::data()
+{
+    if (!mData) {
+        mData = exif_data_new();
     }
 
-    const unsigned char *start = reinterpret_cast<const unsigned char*>(buffer.constData());
-    const unsigned char *end = start + buffer.length();
-    unsigned char *p = reinterpret_cast<unsigned char*>(buffer.data());
+    return mData;
+}
 
-    // Read segments until EOF is reached
+qint64 JpegFile::parseSteps() const
+{
+    return mParseSteps;
+}
+
+void JpegFile::setHashImageData(bool hashImageData)
+{
+    mHashImageData = hashImageData;
+}
+
+QByteArray JpegFile::imageHash() const
+{
+    return mImageHash;
+}
+
+bool JpegFile::parse(QIODevice *device)
+{
+    mSize = device->size();
+
+    StatsTimer timer(Stats::Parse);
+    JpegReader reader(device);
+    QScopedPointer<QCryptographicHash> hash(
+        mHashImageData ? new QCryptographicHash(QCryptographicHash::Md5) : nullptr
+    );
+    bool success = parseSegments(reader, hash.data());
+    mParseSteps = reader.steps();
+    if (success && hash) {
+        mImageHash = hash->result();
+    }
+    return success;
+}
+
+bool JpegFile::parseSegments(JpegReader &reader, QCryptographicHash *hash)
+{
+    // Read segments until EOF is reached - every iteration advances the
+    // reader by at least two bytes, so the amount of work is bounded by the
+    // file size regardless of the content
     while (true) {
 
-        // Remember the beginning of the segment
-        const unsigned char *segmentStart = p;
+        // Skip any fill bytes and remember the beginning of the segment
+        reader.skipFillBytes();
+        qint64 segmentStart = reader.pos();
 
-        // Read the marker
+        // Read the marker, which must begin with 0xff
         quint16 marker;
-        if (!readQuint16(p, end, marker)) {
+        if (!reader.readQuint16(marker) || (marker & 0xff00) != 0xff00) {
             return false;
         }
 
@@ -83,119 +171,185 @@ bool JpegFile::open()
             break;
         }
 
+        Segment segment;
+        segment.marker = marker;
+
         // Two different types of segments exist - start-of-scan which
         // requires searching content for the end of the segment and all other
         // types which include a 16-bit unsigned int indicating size
-        int segmentSize;
         if (marker == 0xffda) {
-            if (!findNextSegment(p, end)) {
+
+            // Record the location of the scan rather than its content
+            // The marker was already read, so it is added to the hash before
+            // the rest of the scan
+            if (hash) {
+                QByteArray buffer;
+                writeQuint16(buffer, marker);
+                hash->addData(buffer);
+            }
+            if (!reader.findNextSegment(hash)) {
                 return false;
             }
-            segmentSize = p - segmentStart;
+            segment.offset = segmentStart;
+            segment.size = reader.pos() - segmentStart;
+
         } else {
+
+            // The size includes the two bytes used to store it
             quint16 dataSize;
-            if (!readQuint16(p, end, dataSize) || p + dataSize >= end) {
+            if (!reader.readQuint16(dataSize) || dataSize < sizeof(quint16)) {
                 return false;
             }
-            p += dataSize - 2;
-            segmentSize = sizeof(quint16) + dataSize;
-        }
-
-        // For the APP1 segment (EXIF), initialize mData; for all other
-        // segments, create a QByteArray and append it to the list
-        if (marker == 0xffe1) {
-            mData = exif_data_new_from_data(
-                segmentStart,
-                segmentSize
-            );
-            if (!mData) {
+            writeQuint16(segment.data, marker);
+            writeQuint16(segment.data, dataSize);
+            if (!reader.read(segment.data, dataSize - sizeof(quint16))) {
                 return false;
             }
-        } else {
-            mSegments.append(QByteArray(reinterpret_cast<const char*>(segmentStart), segmentSize));
+            segment.offset = -1;
+            segment.size = -1;
+
+            // For the first APP1 segment containing EXIF data, initialize
+            // mData; all other segments (including XMP, which also uses APP1)
+            // are added to the list
+            if (marker == 0xffe1 && !mData && isExifSegment(segment.data)) {
+                StatsTimer exifTimer(Stats::ExifParse);
+                mData = exif_data_new_from_data(
+                    reinterpret_cast<const unsigned char*>(segment.data.constData()),
+                    segment.data.length()
+                );
+                if (!mData) {
+                    return false;
+                }
+                continue;
+            }
+
+            if (hash && !isMetadataMarker(marker)) {
+                hash->addData(segment.data);
+            }
         }
+
+        mSegments.append(segment);
     }
 
     return true;
 }
 
-bool JpegFile::save()
+bool JpegFile::write(qint64 &bytesWritten)
 {
-    // Create a buffer to store the file content
+    // Create a buffer for the start-of-image and EXIF segments
     QByteArray buffer;
+    {
+        StatsTimer timer(Stats::Serialize);
 
-    // Write the start-of-image segment
-    writeQuint16(buffer, 0xffd8);
+        writeQuint16(buffer, 0xffd8);
 
-    // Write the EXIF segment
-    unsigned char *data;
-    unsigned int dataSize;
-    exif_data_save_data(mData, &data, &dataSize);
-    if (!dataSize) {
+        unsigned char *data;
+        unsigned int dataSize = 0;
+        exif_data_save_data(this->data(), &data, &dataSize);
+        if (!dataSize) {
+            return false;
+        }
+        if (dataSize > MaxSegmentSize) {
+            free(data);
+            return false;
+        }
+        writeQuint16(buffer, 0xffe1);
+        writeQuint16(buffer, dataSize + sizeof(quint16));
+        buffer.append(reinterpret_cast<const char*>(data), dataSize);
+        free(data);
+    }
+
+    StatsTimer timer(Stats::Write);
+
+    // Image data is copied from the source file
+    QFile source(mSourceFilename);
+    if (!source.open(QIODevice::ReadOnly) || !isSourceUnchanged(source)) {
         return false;
     }
-    writeQuint16(buffer, 0xffe1);
-    writeQuint16(buffer, dataSize + sizeof(quint16));
-    buffer.append(reinterpret_cast<const char*>(data), dataSize);
-    free(data);
-
-    // Write the other segments
-    foreach (const QByteArray &segment, mSegments) {
-        buffer.append(segment);
+
+    // Write to a temporary file that replaces the destination once complete,
+    // which also allows the source and destination to be the same file
+    QSaveFile file(mFilename);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    if (file.write(buffer) != buffer.length()) {
+        return false;
+    }
+
+    // Write the other segments, noting where the image data ends up so that
+    // the new file can be used as the source from now on
+    QList<qint64> offsets;
+    foreach (const Segment &segment, mSegments) {
+        offsets.append(file.pos());
+        if (segment.size == -1) {
+            if (file.write(segment.data) != segment.data.length()) {
+                return false;
+            }
+        } else if (!copyRange(&source, &file, segment.offset, segment.size)) {
+            return false;
+        }
     }
 
     // Write the end-of-image segment
+    buffer.clear();
     writeQuint16(buffer, 0xffd9);
+    if (file.write(buffer) != buffer.length()) {
+        return false;
+    }
 
-    // Open the file for writing
-    QFile file(mFilename);
-    if (!file.open(QIODevice::WriteOnly)) {
+    bytesWritten = file.pos();
+    source.close();
+    if (!file.commit()) {
         return false;
     }
 
-    // Write the buffer
-    qint64 bytesWritten = file.write(buffer);
-    file.close();
+    for (int i = 0; i < mSegments.count(); ++i) {
+        if (mSegments.at(i).size != -1) {
+            mSegments[i].offset = offsets.at(i);
+        }
+    }
+    mSourceFilename = mFilename;
+    mSize = bytesWritten;
+    mModified = QFileInfo(mFilename).lastModified();
 
-    return bytesWritten == buffer.length();
+    return true;
 }
 
-ExifData *JpegFile::data()
+bool JpegFile::isSourceUnchanged(const QFile &source) const
 {
-    if (!mData) {
-        mData = exif_data_new();
-    }
+    return source.size() == mSize && QFileInfo(source).lastModified() == mModified;
+}
 
-    return mData;
+bool JpegFile::isMetadataMarker(quint16 marker)
+{
+    // Application segments and comments contain metadata (EXIF, XMP, ICC
+    // profiles, etc.) rather than image data
+    return (marker & 0xfff0) == 0xffe0 || marker == 0xfffe;
 }
 
-bool JpegFile::readQuint16(unsigned char *&p, const unsigned char *end, quint16 &value)
+bool JpegFile::isExifSegment(const QByteArray &segment)
 {
-    if (p + sizeof(quint16) > end) {
-        return false;
-    }
-    value = qToBigEndian(*reinterpret_cast<quint16*>(p));
-    p += sizeof(quint16);
-    return true;
+    // Marker, size, and the "Exif\0\0" identifier
+    return segment.length() >= 10 && memcmp(segment.constData() + 4, "Exif\0\0", 6) == 0;
 }
 
-bool JpegFile::findNextSegment(unsigned char *&p, const unsigned char *end)
+bool JpegFile::copyRange(QIODevice *source, QIODevice *destination, qint64 offset, qint64 size)
 {
-    while (true) {
-        while (p < end && *p != 0xff) {
-            ++p;
-        }
-        if (p + 1 >= end) {
+    if (!source->seek(offset)) {
+        return false;
+    }
+
+    QByteArray buffer(CopyChunkSize, 0);
+    while (size) {
+        qint64 bytesRead = source->read(buffer.data(), qMin(size, CopyChunkSize));
+        if (bytesRead <= 0 || destination->write(buffer.constData(), bytesRead) != bytesRead) {
             return false;
         }
-        unsigned char q = *(p + 1);
-        if (q == 0x00 || q & 0xf8 == 0xd0) {
-            p += 2;
-            continue;
-        } else {
-            return true;
-        }
+        size -= bytesRead;
     }
+
+    return true;
 }
 
 void JpegFile::writeQuint16(QByteArray &buffer, quint16 value)
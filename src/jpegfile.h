@@ -28,15 +28,33 @@
 #include <libexif/exif-data.h>
 
 #include <QByteArray>
+#include <QDateTime>
 #include <QList>
 
+class QCryptographicHash;
 class QFile;
+class QIODevice;
+
+class JpegReader;
 
 /**
  * @brief JPEG file loaded in memory
  *
  * In order to write a JPEG file with updated EXIF data, each segment in the
- * file must be preserved for later reassembly.
+ * file must be preserved for later reassembly. Header segments are small and
+ * kept in memory, but the entropy-coded image data following start-of-scan
+ * is only recorded as a range of the source file and copied from there when
+ * saving, so memory use is bounded by the size of the headers rather than
+ * the size of the file. Saving fails if the size or modification time of
+ * the source has changed since it was parsed, as the recorded ranges would
+ * no longer be valid.
+ *
+ * Segments can also be parsed from any device (such as a QBuffer), although
+ * saving always reads image data from the file itself. If requested before
+ * opening, the image data is hashed as it is parsed so that hashing does not
+ * read the file twice. The number of reader operations used by the last
+ * parse is available from parseSteps(), which the fuzzing tests use to
+ * confirm that the work done is proportional to the size of the input.
  */
 class JpegFile
 {
@@ -46,19 +64,53 @@ public:
     virtual ~JpegFile();
 
     bool open();
+    bool open(QIODevice *device);
     bool save();
 
+    QString filename() const;
+    void setFilename(const QString &filename);
+
     ExifData *data();
 
+    void setHashImageData(bool hashImageData);
+    QByteArray imageHash() const;
+
+    qint64 parseSteps() const;
+
 private:
 
-    bool readQuint16(unsigned char *&p, const unsigned char *end, quint16 &value);
-    bool findNextSegment(unsigned char *&p, const unsigned char *end);
+    struct Segment
+    {
+        quint16 marker;
+
+        // Either the content of the segment or its location in the source
+        QByteArray data;
+        qint64 offset;
+        qint64 size;
+    };
 
-    void writeQuint16(QByteArray &buffer, quint16 value);
+    bool parse(QIODevice *device);
+    bool parseSegments(JpegReader &reader, QCryptographicHash *hash);
+    bool write(qint64 &bytesWritten);
+
+    bool isSourceUnchanged(const QFile &source) const;
+
+    bool isExifSegment(const QByteArray &segment);
+
+    static bool isMetadataMarker(quint16 marker);
+
+    static bool copyRange(QIODevice *source, QIODevice *destination, qint64 offset, qint64 size);
+    static void writeQuint16(QByteArray &buffer, quint16 value);
 
     QString mFilename;
-    QList<QByteArray> mSegments;
+    QString mSourceFilename;
+    qint64 mSize;
+    QDateTime mModified;
+    qint64 mParseSteps;
+
+    bool mHashImageData;
+    QByteArray mImageHash;
+    QList<Segment> mSegments;
 
     ExifData *mData;
 };
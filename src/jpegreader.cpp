@@ -0,0 +1,159 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <cstring>
+
+#include <QCryptographicHash>
+#include <QIODevice>
+#include <QtEndian>
+
+#include "jpegreader.h"
+
+// Size of the buffer used for reading from the device
+const int ChunkSize = 64 * 1024;
+
+JpegReader::JpegReader(QIODevice *device)
+    : mDevice(device),
+      mBuffer(ChunkSize, 0),
+      mOffset(device->pos()),
+      mIndex(0),
+      mLength(0),
+      mSteps(0)
+{
+}
+
+qint64 JpegReader::pos() const
+{
+    return mOffset + mIndex;
+}
+
+qint64 JpegReader::steps() const
+{
+    return mSteps;
+}
+
+void JpegReader::skipFillBytes()
+{
+    // Any number of 0xff fill bytes may precede a marker
+    while (fill(2) &&
+            static_cast<unsigned char>(mBuffer.at(mIndex)) == 0xff &&
+            static_cast<unsigned char>(mBuffer.at(mIndex + 1)) == 0xff) {
+        ++mSteps;
+        ++mIndex;
+    }
+}
+
+bool JpegReader::readQuint16(quint16 &value)
+{
+    ++mSteps;
+    if (!fill(sizeof(quint16))) {
+        return false;
+    }
+    value = qFromBigEndian<quint16>(reinterpret_cast<const uchar*>(mBuffer.constData() + mIndex));
+    mIndex += sizeof(quint16);
+    return true;
+}
+
+bool JpegReader::read(QByteArray &buffer, int size)
+{
+    ++mSteps;
+    while (size) {
+        if (!fill(1)) {
+            return false;
+        }
+        int length = qMin(size, mLength - mIndex);
+        buffer.append(mBuffer.constData() + mIndex, length);
+        mIndex += length;
+        size -= length;
+    }
+    return true;
+}
+
+bool JpegReader::findNextSegment(QCryptographicHash *hash)
+{
+    while (true) {
+        ++mSteps;
+
+        // Search the remainder of the buffer for 0xff
+        if (!fill(1)) {
+            return false;
+        }
+        const char *start = mBuffer.constData() + mIndex;
+        const char *p = static_cast<const char*>(memchr(start, 0xff, mLength - mIndex));
+        if (!p) {
+            skip(mLength - mIndex, hash);
+            continue;
+        }
+        skip(p - start, hash);
+
+        // Examine the byte that follows
+        if (!fill(2)) {
+            return false;
+        }
+        unsigned char q = mBuffer.at(mIndex + 1);
+        if (q == 0xff) {
+            // Fill byte preceding a marker
+            skip(1, hash);
+        } else if (q == 0x00 || (q & 0xf8) == 0xd0) {
+            // Stuffed zero byte or restart marker within the scan
+            skip(2, hash);
+        } else {
+            return true;
+        }
+    }
+}
+
+void JpegReader::skip(int size, QCryptographicHash *hash)
+{
+    // Bytes must be hashed before they are discarded by fill()
+    if (hash) {
+        hash->addData(mBuffer.constData() + mIndex, size);
+    }
+    mIndex += size;
+}
+
+bool JpegReader::fill(int size)
+{
+    if (mLength - mIndex >= size) {
+        return true;
+    }
+
+    // Move the unread bytes to the front of the buffer and read more data
+    // after them
+    int remaining = mLength - mIndex;
+    memmove(mBuffer.data(), mBuffer.constData() + mIndex, remaining);
+    mOffset += mIndex;
+    mIndex = 0;
+    mLength = remaining;
+
+    while (mLength < size) {
+        qint64 bytesRead = mDevice->read(mBuffer.data() + mLength, ChunkSize - mLength);
+        if (bytesRead <= 0) {
+            return false;
+        }
+        mLength += bytesRead;
+    }
+
+    return true;
+}
@@ -0,0 +1,74 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef JPEGREADER_H
+#define JPEGREADER_H
+
+#include <QByteArray>
+
+class QCryptographicHash;
+class QIODevice;
+
+/**
+ * @brief Sequential reader for JPEG segments
+ *
+ * Data is read through a small fixed-size buffer that is reused for the
+ * entire file, so memory use does not depend on the size of the file and
+ * offsets are not limited to the range of an int.
+ *
+ * Every operation is counted and consumes at least one byte (apart from the
+ * final step of each search), so steps() stays proportional to the size of
+ * the input for any content. The bytes passed over while searching for the
+ * end of a scan can also be added to a hash, so that image data is hashed
+ * without being read a second time.
+ */
+class JpegReader
+{
+public:
+
+    explicit JpegReader(QIODevice *device);
+
+    qint64 pos() const;
+    qint64 steps() const;
+
+    void skipFillBytes();
+    bool readQuint16(quint16 &value);
+    bool read(QByteArray &buffer, int size);
+    bool findNextSegment(QCryptographicHash *hash = nullptr);
+
+private:
+
+    bool fill(int size);
+    void skip(int size, QCryptographicHash *hash);
+
+    QIODevice *mDevice;
+
+    QByteArray mBuffer;
+    qint64 mOffset;
+    int mIndex;
+    int mLength;
+    qint64 mSteps;
+};
+
+#endif // JPEGREADER_H
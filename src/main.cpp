@@ -22,21 +22,273 @@
  * IN THE SOFTWARE.
  */
 
+#include <cstdio>
+#include <cstring>
+
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QScopedPointer>
 
+#include "datetimeshifter.h"
+#include "filelist.h"
+#ifdef Q_OS_LINUX
+#include "folderwatcher.h"
+#endif
+#include "imagehasher.h"
 #include "mainwindow.h"
+#include "metadataserver.h"
+#ifdef Q_OS_UNIX
+#include "signalhandler.h"
+#endif
+#include "stats.h"
+#include "tagcomparer.h"
+#include "tagimporter.h"
+#include "thumbnailgenerator.h"
+
+// Options that run a batch command instead of showing the editor window
+static const char *const BatchOptions[] = {
+    "--diff",
+    "--hash",
+    "--import",
+    "--serve",
+    "--shift-time",
+    "--sync",
+    "--thumbnails",
+    "--watch"
+};
+
+static bool isBatch(int argc, char **argv)
+{
+    for (int i = 1; i < argc; ++i) {
+        for (const char *option : BatchOptions) {
+            size_t length = strlen(option);
+            if (strncmp(argv[i], option, length) == 0 &&
+                    (argv[i][length] == '\0' || argv[i][length] == '=')) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static void writeStats(const QString &filename)
+{
+    QFile file(filename);
+    bool opened = filename.isEmpty() ?
+        file.open(stderr, QIODevice::WriteOnly) :
+        file.open(QIODevice::WriteOnly);
+    if (opened) {
+        file.write(Stats::dump());
+    }
+}
 
 int main(int argc, char **argv)
 {
-    QApplication a(argc, argv);
+    // Batch commands run without a display, so only create a QApplication
+    // when the editor window is going to be shown
+    QScopedPointer<QCoreApplication> app(
+        isBatch(argc, argv) ?
+            new QCoreApplication(argc, argv) :
+            new QApplication(argc, argv)
+    );
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Extremely Simple EXIF Editor");
+    parser.addHelpOption();
+    parser.addPositionalArgument("files", "JPEG image to open (or images to process in batch mode).", "[files...]");
+
+    QCommandLineOption importOption(
+        "import",
+        "Apply tag values from a CSV or NDJSON manifest of (path, tag, value) rows.",
+        "manifest"
+    );
+    parser.addOption(importOption);
+
+    QCommandLineOption diffOption(
+        "diff",
+        "Print the tags of each file that differ from those of a reference file.",
+        "reference"
+    );
+    parser.addOption(diffOption);
+
+    QCommandLineOption syncOption(
+        "sync",
+        "Copy the tags given by --tags from a reference file to each file.",
+        "reference"
+    );
+    parser.addOption(syncOption);
+
+    QCommandLineOption tagsOption(
+        "tags",
+        "Comma-separated list of tags copied by --sync.",
+        "names"
+    );
+    parser.addOption(tagsOption);
+
+    QCommandLineOption hashOption(
+        "hash",
+        "Print a hash of the image data (excluding metadata) of each file."
+    );
+    parser.addOption(hashOption);
+
+    QCommandLineOption serveOption(
+        "serve",
+        "Serve read and edit requests over a local socket until terminated."
+    );
+    parser.addOption(serveOption);
+
+    QCommandLineOption socketOption(
+        "socket",
+        "Name or path of the local socket used by --serve.",
+        "name",
+        "esee"
+    );
+    parser.addOption(socketOption);
+
+    QCommandLineOption shiftTimeOption(
+        "shift-time",
+        "Shift DateTime, DateTimeOriginal, and DateTimeDigitized of each file in place by [-][[[days:]hours:]minutes:]seconds.",
+        "offset"
+    );
+    parser.addOption(shiftTimeOption);
+
+    QCommandLineOption thumbnailsOption(
+        "thumbnails",
+        "Regenerate the embedded thumbnail of each file (or of each file in the manifest when used with --import)."
+    );
+    parser.addOption(thumbnailsOption);
+
+#ifdef Q_OS_LINUX
+    QCommandLineOption watchOption(
+        "watch",
+        "Watch the folders in a JSON configuration file and apply tag rules to images as they arrive.",
+        "config"
+    );
+    parser.addOption(watchOption);
+#endif
+
+    QCommandLineOption statsOption(
+        "stats",
+        "Collect timing and I/O statistics and write them on exit as text, prometheus, or trace (Chrome trace JSON).",
+        "format"
+    );
+    parser.addOption(statsOption);
+
+    QCommandLineOption statsFileOption(
+        "stats-file",
+        "Write statistics to a file instead of stderr.",
+        "file"
+    );
+    parser.addOption(statsFileOption);
+
+    parser.process(*app);
 
-    MainWindow mainWindow;
-    mainWindow.show();
+    // Enable statistics before any files are touched
+    if (parser.isSet(statsOption)) {
+        Stats::Format format;
+        if (!Stats::formatFromName(parser.value(statsOption), format)) {
+            fprintf(stderr, "unknown statistics format \"%s\"\n", qPrintable(parser.value(statsOption)));
+            return 1;
+        }
+        Stats::enable(format);
+    }
+
+    int ret;
+
+    if (parser.isSet(importOption)) {
+
+        // Apply the manifest, grouping edits so each file is saved once
+        TagImporter importer;
+        importer.setRegenerateThumbnails(parser.isSet(thumbnailsOption));
+        if (importer.load(parser.value(importOption))) {
+            ret = importer.apply() ? 1 : 0;
+        } else {
+            ret = 1;
+        }
+
+    } else if (parser.isSet(diffOption)) {
+
+        TagComparer comparer;
+        if (comparer.loadReference(parser.value(diffOption))) {
+            ret = comparer.diff(FileList::expand(parser.positionalArguments())) ? 1 : 0;
+        } else {
+            ret = 1;
+        }
+
+    } else if (parser.isSet(syncOption)) {
+
+        TagComparer comparer;
+        if (!comparer.setSyncTags(parser.value(tagsOption))) {
+            fprintf(stderr, "--sync requires a list of tags (--tags)\n");
+            ret = 1;
+        } else if (comparer.loadReference(parser.value(syncOption))) {
+            ret = comparer.sync(FileList::expand(parser.positionalArguments())) ? 1 : 0;
+        } else {
+            ret = 1;
+        }
+
+    } else if (parser.isSet(hashOption)) {
+
+        ret = ImageHasher::hash(FileList::expand(parser.positionalArguments())) ? 1 : 0;
+
+    } else if (parser.isSet(serveOption)) {
+
+        MetadataServer server;
+        if (server.listen(parser.value(socketOption))) {
+#ifdef Q_OS_UNIX
+            // Exit cleanly (writing statistics) when interrupted or terminated
+            SignalHandler signalHandler;
+#endif
+            ret = app->exec();
+        } else {
+            fprintf(stderr, "unable to listen on \"%s\"\n", qPrintable(parser.value(socketOption)));
+            ret = 1;
+        }
+
+    } else if (parser.isSet(shiftTimeOption)) {
+
+        qint64 seconds;
+        if (DateTimeShifter::parseOffset(parser.value(shiftTimeOption), seconds)) {
+            ret = DateTimeShifter::shift(FileList::expand(parser.positionalArguments()), seconds) ? 1 : 0;
+        } else {
+            fprintf(stderr, "invalid offset \"%s\"\n", qPrintable(parser.value(shiftTimeOption)));
+            ret = 1;
+        }
+
+    } else if (parser.isSet(thumbnailsOption)) {
+
+        ret = ThumbnailGenerator::regenerate(FileList::expand(parser.positionalArguments())) ? 1 : 0;
+
+#ifdef Q_OS_LINUX
+    } else if (parser.isSet(watchOption)) {
+
+        FolderWatcher watcher;
+        if (watcher.load(parser.value(watchOption))) {
+            // Exit cleanly (writing statistics) when interrupted or terminated
+            SignalHandler signalHandler;
+            ret = app->exec();
+        } else {
+            ret = 1;
+        }
+#endif
+
+    } else {
+
+        MainWindow mainWindow;
+        mainWindow.show();
+
+        // If an argument was supplied, attempt to open the file
+        if (!parser.positionalArguments().isEmpty()) {
+            mainWindow.openImage(parser.positionalArguments().first());
+        }
+
+        ret = app->exec();
+    }
 
-    // If an argument was supplied, attempt to open the file
-    if (a.arguments().count() >= 2) {
-        mainWindow.openImage(a.arguments().at(1));
+    if (Stats::isEnabled()) {
+        writeStats(parser.value(statsFileOption));
     }
 
-    return a.exec();
+    return ret;
 }
@@ -33,32 +33,50 @@
 #include <QMenuBar>
 #include <QMessageBox>
 #include <QSpacerItem>
+#include <QUndoStack>
 #include <QVBoxLayout>
 #include <QWidget>
 
+#include "exifutils.h"
 #include "jpegfile.h"
 #include "mainwindow.h"
+#include "stats.h"
 #include "stringtagwidget.h"
+#include "tagcommand.h"
 
 MainWindow::MainWindow()
     : mSave(new QAction(tr("&Save"), this)),
       mSaveAs(new QAction(tr("&Save &As..."), this)),
-      mFile(nullptr),
-      mDirty(false)
+      mRevert(new QAction(tr("&Revert"), this)),
+      mUndoStack(new QUndoStack(this)),
+      mFile(nullptr)
 {
     connect(mSave, &QAction::triggered, this, &MainWindow::onSave);
     connect(mSaveAs, &QAction::triggered, this, &MainWindow::onSaveAs);
+    connect(mRevert, &QAction::triggered, this, &MainWindow::onRevert);
+    connect(mUndoStack, &QUndoStack::cleanChanged, this, &MainWindow::updateTitle);
 
     mSave->setEnabled(false);
     mSaveAs->setEnabled(false);
+    mRevert->setEnabled(false);
 
     QMenu *file = menuBar()->addMenu(tr("&File"));
     file->addAction(tr("&Open..."), this, &MainWindow::onOpen);
     file->addAction(mSave);
     file->addAction(mSaveAs);
+    file->addAction(mRevert);
     file->addSeparator();
     file->addAction(tr("&Quit"), this, &MainWindow::close);
 
+    QAction *undo = mUndoStack->createUndoAction(this, tr("&Undo"));
+    undo->setShortcuts(QKeySequence::Undo);
+    QAction *redo = mUndoStack->createRedoAction(this, tr("&Redo"));
+    redo->setShortcuts(QKeySequence::Redo);
+
+    QMenu *edit = menuBar()->addMenu(tr("&Edit"));
+    edit->addAction(undo);
+    edit->addAction(redo);
+
     // Create all of the widgets
     mWidgets.append(new StringTagWidget(EXIF_IFD_0, "Make"));
     mWidgets.append(new StringTagWidget(EXIF_IFD_0, "Model"));
@@ -105,29 +123,33 @@ void MainWindow::openImage(const QString &filename)
         return;
     }
 
-    // Free an existing image
+    // Free an existing image (the undo stack refers to its data)
+    mUndoStack->clear();
     if (mFile) {
         delete mFile;
     }
     mFile = file;
 
     // Update each of the widgets
-    foreach (AbstractTagWidget *widget, mWidgets) {
-        widget->setEnabled(true);
-        widget->read(file->data());
+    {
+        StatsTimer timer(Stats::WidgetRead);
+        foreach (AbstractTagWidget *widget, mWidgets) {
+            widget->setEnabled(true);
+            widget->read(file->data());
+        }
     }
 
     // Update the rest of the UI
     mSave->setEnabled(true);
     mSaveAs->setEnabled(true);
     mFilename = filename;
-    mDirty = false;
     updateTitle();
 }
 
 void MainWindow::closeEvent(QCloseEvent *event)
 {
-    if (mDirty) {
+    commitEdits();
+    if (!mUndoStack->isClean()) {
         QMessageBox::StandardButton button = QMessageBox::warning(
             this,
             tr("Warning"),
@@ -155,9 +177,10 @@ void MainWindow::onOpen()
 
 void MainWindow::onSave()
 {
-    // Update data for each of the widgets
-    foreach (AbstractTagWidget *widget, mWidgets) {
-        widget->write(mFile->data());
+    // Record any edit still in progress
+    {
+        StatsTimer timer(Stats::WidgetWrite);
+        commitEdits();
     }
 
     if (!mFile->save()) {
@@ -169,7 +192,7 @@ void MainWindow::onSave()
         return;
     }
 
-    mDirty = false;
+    mUndoStack->setClean();
     updateTitle();
 }
 
@@ -183,15 +206,52 @@ void MainWindow::onSaveAs()
     );
     if (!filename.isNull()) {
         mFilename = filename;
+        mFile->setFilename(filename);
         onSave();
     }
 }
 
+void MainWindow::onRevert()
+{
+    commitEdits();
+
+    // Undo (or redo) back to the last saved state without re-reading the
+    // file; if that state is no longer on the stack, reload the image
+    if (mUndoStack->cleanIndex() == -1) {
+        openImage(mFilename);
+    } else {
+        mUndoStack->setIndex(mUndoStack->cleanIndex());
+    }
+}
+
 void MainWindow::onChanged()
 {
-    if (!mDirty) {
-        mDirty = true;
-        updateTitle();
+    commitEdit(qobject_cast<AbstractTagWidget*>(sender()));
+}
+
+void MainWindow::commitEdits()
+{
+    foreach (AbstractTagWidget *widget, mWidgets) {
+        commitEdit(widget);
+    }
+}
+
+void MainWindow::commitEdit(AbstractTagWidget *widget)
+{
+    if (!mFile || !widget->isModified()) {
+        return;
+    }
+
+    // Write the value to the data and record the change (if any); pushing
+    // the command re-reads the widget, which clears the modified flag
+    ExifData *data = mFile->data();
+    TagValue oldValue = ExifUtils::tagValue(data, widget->ifd(), widget->tag());
+    widget->write(data);
+    TagValue newValue = ExifUtils::tagValue(data, widget->ifd(), widget->tag());
+    if (newValue != oldValue) {
+        mUndoStack->push(new TagCommand(data, widget, oldValue, newValue));
+    } else {
+        widget->read(data);
     }
 }
 
@@ -200,9 +260,10 @@ void MainWindow::updateTitle()
     QString title = tr("Extremely Simple EXIF Editor");
     if (!mFilename.isNull()) {
         title = tr("%1 - %2").arg(title).arg(QFileInfo(mFilename).fileName());
-        if (mDirty) {
+        if (!mUndoStack->isClean()) {
             title = tr("%1 (*)").arg(title);
         }
     }
     setWindowTitle(title);
+    mRevert->setEnabled(mFile && !mUndoStack->isClean());
 }
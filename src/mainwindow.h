@@ -29,6 +29,7 @@
 #include <QMainWindow>
 
 class QAction;
+class QUndoStack;
 
 class AbstractTagWidget;
 class JpegFile;
@@ -56,19 +57,25 @@ private slots:
     void onOpen();
     void onSave();
     void onSaveAs();
+    void onRevert();
 
     void onChanged();
 
+    void updateTitle();
+
 private:
 
-    void updateTitle();
+    void commitEdits();
+    void commitEdit(AbstractTagWidget *widget);
 
     QAction *mSave;
     QAction *mSaveAs;
+    QAction *mRevert;
+
+    QUndoStack *mUndoStack;
 
     QString mFilename;
     JpegFile *mFile;
-    bool mDirty;
 
     QList<AbstractTagWidget*> mWidgets;
 };
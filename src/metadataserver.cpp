@@ -0,0 +1,246 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <libexif/exif-content.h>
+#include <libexif/exif-entry.h>
+
+#include <QDir>
+#include <QFutureWatcher>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QLocalSocket>
+#include <QtConcurrent>
+#include <QtEndian>
+
+#include "exifutils.h"
+#include "jpegfile.h"
+#include "metadataserver.h"
+#include "thumbnailgenerator.h"
+
+// Messages larger than this are rejected and the connection closed
+const quint32 MaxMessageSize = 16 * 1024 * 1024;
+
+MetadataServer::MetadataServer(QObject *parent)
+    : QObject(parent)
+{
+    connect(&mServer, &QLocalServer::newConnection, this, &MetadataServer::onNewConnection);
+
+    // Idle threads in the global pool expire after 30 seconds, so the server
+    // uses its own pool that keeps its threads for its lifetime
+    mPool.setExpiryTimeout(-1);
+}
+
+bool MetadataServer::listen(const QString &name)
+{
+    // Don't take over the socket of an instance that is still running
+    QLocalSocket socket;
+    socket.connectToServer(name);
+    if (socket.waitForConnected(1000)) {
+        qWarning("\"%s\" is in use by another instance", qPrintable(name));
+        return false;
+    }
+
+    // Only allow the current user to connect and remove any stale socket
+    // left behind by a previous instance that exited without cleaning up
+    mServer.setSocketOptions(QLocalServer::UserAccessOption);
+    QLocalServer::removeServer(name);
+    return mServer.listen(name);
+}
+
+void MetadataServer::onNewConnection()
+{
+    while (QLocalSocket *socket = mServer.nextPendingConnection()) {
+        connect(socket, &QLocalSocket::readyRead, this, &MetadataServer::onReadyRead);
+        connect(socket, &QLocalSocket::disconnected, this, &MetadataServer::onDisconnected);
+        mBuffers.insert(socket, QByteArray());
+    }
+}
+
+void MetadataServer::onReadyRead()
+{
+    QLocalSocket *socket = qobject_cast<QLocalSocket*>(sender());
+    QByteArray &buffer = mBuffers[socket];
+    buffer.append(socket->readAll());
+
+    // Process each complete message in the buffer
+    while (buffer.length() >= static_cast<int>(sizeof(quint32))) {
+        quint32 size = qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(buffer.constData()));
+        if (size > MaxMessageSize) {
+            socket->abort();
+            return;
+        }
+        if (static_cast<quint32>(buffer.length()) - sizeof(quint32) < size) {
+            break;
+        }
+
+        QJsonDocument document = QJsonDocument::fromJson(buffer.mid(sizeof(quint32), size));
+        buffer.remove(0, sizeof(quint32) + size);
+
+        if (!document.isObject()) {
+            send(socket, error(QJsonObject(), "request must be a JSON object"));
+            continue;
+        }
+
+        Request request;
+        request.socket = socket;
+        request.object = document.object();
+        enqueue(request);
+    }
+}
+
+void MetadataServer::onDisconnected()
+{
+    QLocalSocket *socket = qobject_cast<QLocalSocket*>(sender());
+    mBuffers.remove(socket);
+    socket->deleteLater();
+}
+
+void MetadataServer::enqueue(const Request &request)
+{
+    // Requests for a file already being processed wait their turn
+    QString path = QDir::cleanPath(QDir::current().absoluteFilePath(request.object.value("path").toString()));
+    QList<Request> &queue = mQueues[path];
+    queue.append(request);
+    if (queue.count() == 1) {
+        start(path);
+    }
+}
+
+void MetadataServer::start(const QString &path)
+{
+    QFutureWatcher<QJsonObject> *watcher = new QFutureWatcher<QJsonObject>(this);
+    connect(watcher, &QFutureWatcher<QJsonObject>::finished, this, [this, watcher, path]() {
+        QList<Request> &queue = mQueues[path];
+        Request request = queue.takeFirst();
+        if (request.socket) {
+            send(request.socket, watcher->result());
+        }
+        watcher->deleteLater();
+
+        // Start the next request for the file (if any)
+        if (queue.isEmpty()) {
+            mQueues.remove(path);
+        } else {
+            start(path);
+        }
+    });
+    watcher->setFuture(QtConcurrent::run(&mPool, &MetadataServer::process, mQueues.value(path).first().object));
+}
+
+void MetadataServer::send(QLocalSocket *socket, const QJsonObject &object)
+{
+    QByteArray data = QJsonDocument(object).toJson(QJsonDocument::Compact);
+    quint32 size = qToBigEndian<quint32>(data.length());
+    socket->write(reinterpret_cast<const char*>(&size), sizeof(quint32));
+    socket->write(data);
+}
+
+QJsonObject MetadataServer::process(const QJsonObject &request)
+{
+    QJsonObject response;
+    response.insert("id", request.value("id"));
+
+    QString op = request.value("op").toString();
+    if (op != "read" && op != "edit") {
+        return error(response, QString("unknown operation \"%1\"").arg(op));
+    }
+
+    QString path = request.value("path").toString();
+    JpegFile file(path);
+    if (!file.open()) {
+        return error(response, QString("unable to read %1").arg(path));
+    }
+
+    if (op == "read") {
+        response.insert("tags", readTags(file, request));
+    } else {
+        QJsonObject tags = request.value("tags").toObject();
+        for (auto i = tags.constBegin(); i != tags.constEnd(); ++i) {
+            ExifIfd ifd;
+            ExifTag tag;
+            if (!ExifUtils::findTag(i.key(), ifd, tag)) {
+                return error(response, QString("unknown tag \"%1\"").arg(i.key()));
+            }
+            // A null value removes the tag
+            if (i.value().isNull()) {
+                ExifUtils::removeEntry(file.data(), ifd, tag);
+                continue;
+            }
+            if (!i.value().isString() ||
+                    !ExifUtils::setStringValue(file.data(), ifd, tag, i.value().toString().toUtf8())) {
+                return error(response, QString("invalid value for \"%1\"").arg(i.key()));
+            }
+        }
+        if (request.value("thumbnail").toBool() && !ThumbnailGenerator::regenerate(file)) {
+            return error(response, "unable to regenerate thumbnail");
+        }
+        if (!file.save()) {
+            return error(response, QString("unable to save %1").arg(path));
+        }
+    }
+
+    response.insert("ok", true);
+    return response;
+}
+
+QJsonObject MetadataServer::readTags(JpegFile &file, const QJsonObject &request)
+{
+    QJsonObject tags;
+    ExifData *data = file.data();
+
+    if (request.contains("tags")) {
+        foreach (const QJsonValue &value, request.value("tags").toArray()) {
+            ExifIfd ifd;
+            ExifTag tag;
+            QString name = value.toString();
+            if (ExifUtils::findTag(name, ifd, tag) && exif_content_get_entry(data->ifd[ifd], tag)) {
+                tags.insert(name, ExifUtils::stringValue(data, ifd, tag));
+            }
+        }
+    } else {
+
+        // Tags such as XResolution appear in both IFD0 and IFD1; searching the
+        // IFDs in the same order as findTag() returns the main image's value
+        // and matches the entry that an edit of the same name would change
+        foreach (ExifIfd ifd, ExifUtils::ifds()) {
+            ExifContent *content = data->ifd[ifd];
+            for (unsigned int j = 0; j < content->count; ++j) {
+                ExifEntry *entry = content->entries[j];
+                const char *name = exif_tag_get_name_in_ifd(entry->tag, ifd);
+                if (name && !tags.contains(name)) {
+                    tags.insert(name, ExifUtils::stringValue(data, ifd, entry->tag));
+                }
+            }
+        }
+    }
+
+    return tags;
+}
+
+QJsonObject MetadataServer::error(QJsonObject response, const QString &message)
+{
+    response.insert("ok", false);
+    response.insert("error", message);
+    return response;
+}
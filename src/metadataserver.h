@@ -0,0 +1,102 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef METADATASERVER_H
+#define METADATASERVER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QJsonObject>
+#include <QList>
+#include <QLocalServer>
+#include <QObject>
+#include <QPointer>
+#include <QThreadPool>
+
+class QLocalSocket;
+
+class JpegFile;
+
+/**
+ * @brief Serve metadata requests over a local socket
+ *
+ * Each message (in either direction) is a JSON object preceded by its size
+ * as a 32-bit big-endian integer. Requests are processed by a dedicated pool
+ * of worker threads that never expire, so they persist for the lifetime of
+ * the server and avoid the cost of starting a new process for each file.
+ * Requests for the same file are processed in the order they were received.
+ *
+ * Supported requests:
+ *
+ *     {"id": ..., "op": "read", "path": "...", "tags": ["Make", ...]}
+ *     {"id": ..., "op": "edit", "path": "...", "tags": {"Make": "...", ...}, "thumbnail": false}
+ *
+ * If "tags" is omitted from a read request, all tags are returned; a tag
+ * present in more than one IFD is reported once, from the first IFD in the
+ * order searched by ExifUtils::findTag() (so IFD0 takes precedence over the
+ * thumbnail's IFD1). Responses include the request's "id", an "ok" boolean,
+ * and either "tags" or "error".
+ */
+class MetadataServer : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    explicit MetadataServer(QObject *parent = nullptr);
+
+    bool listen(const QString &name);
+
+private slots:
+
+    void onNewConnection();
+    void onReadyRead();
+    void onDisconnected();
+
+private:
+
+    struct Request
+    {
+        QPointer<QLocalSocket> socket;
+        QJsonObject object;
+    };
+
+    void enqueue(const Request &request);
+    void start(const QString &path);
+    void send(QLocalSocket *socket, const QJsonObject &object);
+
+    static QJsonObject process(const QJsonObject &request);
+    static QJsonObject readTags(JpegFile &file, const QJsonObject &request);
+    static QJsonObject error(QJsonObject response, const QString &message);
+
+    QLocalServer mServer;
+    QHash<QLocalSocket*, QByteArray> mBuffers;
+    QHash<QString, QList<Request> > mQueues;
+
+    // Destroyed first so that running requests finish before the rest of
+    // the server is torn down
+    QThreadPool mPool;
+};
+
+#endif // METADATASERVER_H
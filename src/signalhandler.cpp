@@ -0,0 +1,94 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <csignal>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <QCoreApplication>
+#include <QSocketNotifier>
+
+#include "signalhandler.h"
+
+// Signals that end the event loop
+const int Signals[] = { SIGINT, SIGTERM };
+
+// Written by the signal handler and read by the event loop
+static int gFds[2] = { -1, -1 };
+
+SignalHandler::SignalHandler(QObject *parent)
+    : QObject(parent),
+      mNotifier(nullptr)
+{
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, gFds) == -1) {
+        gFds[0] = gFds[1] = -1;
+        return;
+    }
+    for (int fd : gFds) {
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+
+    mNotifier = new QSocketNotifier(gFds[1], QSocketNotifier::Read, this);
+    connect(mNotifier, &QSocketNotifier::activated, this, &SignalHandler::onActivated);
+
+    struct sigaction action = {};
+    action.sa_handler = &SignalHandler::handle;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    for (int signal : Signals) {
+        sigaction(signal, &action, nullptr);
+    }
+}
+
+SignalHandler::~SignalHandler()
+{
+    if (gFds[0] == -1) {
+        return;
+    }
+
+    for (int signal : Signals) {
+        ::signal(signal, SIG_DFL);
+    }
+    close(gFds[0]);
+    close(gFds[1]);
+    gFds[0] = gFds[1] = -1;
+}
+
+void SignalHandler::onActivated()
+{
+    char buffer[16];
+    while (read(gFds[1], buffer, sizeof(buffer)) > 0);
+
+    QCoreApplication::quit();
+}
+
+void SignalHandler::handle(int)
+{
+    char c = 0;
+    ssize_t ret = write(gFds[0], &c, sizeof(c));
+    Q_UNUSED(ret);
+}
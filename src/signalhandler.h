@@ -0,0 +1,61 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef SIGNALHANDLER_H
+#define SIGNALHANDLER_H
+
+#include <QObject>
+
+class QSocketNotifier;
+
+/**
+ * @brief Quit the event loop when SIGINT or SIGTERM is received
+ *
+ * Long-running modes (such as --serve and --watch) only end when signalled,
+ * so the signals are turned into a normal exit, allowing destructors to run
+ * and statistics to be written. The signal handler writes to a socket pair
+ * that is watched by the event loop, since nothing else is safe to call from
+ * a signal handler.
+ */
+class SignalHandler : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    explicit SignalHandler(QObject *parent = nullptr);
+    virtual ~SignalHandler();
+
+private slots:
+
+    void onActivated();
+
+private:
+
+    static void handle(int signal);
+
+    QSocketNotifier *mNotifier;
+};
+
+#endif // SIGNALHANDLER_H
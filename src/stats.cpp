@@ -0,0 +1,315 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <QAtomicInteger>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QVector>
+
+#include "stats.h"
+
+// Values are placed into power-of-two buckets, so bucket n holds values
+// strictly less than 2^n; 48 buckets cover ~78 hours in nanoseconds and
+// 256 TB in bytes
+const int HistogramBuckets = 48;
+
+struct Histogram
+{
+    void add(qint64 value);
+
+    QAtomicInteger<qint64> buckets[HistogramBuckets];
+    QAtomicInteger<qint64> count;
+    QAtomicInteger<qint64> sum;
+};
+
+void Histogram::add(qint64 value)
+{
+    int bucket = 0;
+    while (bucket < HistogramBuckets - 1 && value >> bucket) {
+        ++bucket;
+    }
+    buckets[bucket].fetchAndAddRelaxed(1);
+    count.fetchAndAddRelaxed(1);
+    sum.fetchAndAddRelaxed(value);
+}
+
+struct TraceEvent
+{
+    Stats::Phase phase;
+    int thread;
+    qint64 start;
+    qint64 duration;
+};
+
+const char *const PhaseNames[Stats::PhaseCount] = {
+    "read",
+    "parse",
+    "exif_parse",
+    "serialize",
+    "write",
+    "hash",
+    "widget_read",
+    "widget_write"
+};
+
+const char *const FormatNames[] = {
+    "text",
+    "prometheus",
+    "trace"
+};
+
+// Written once by enable() before any worker threads are started
+static bool gEnabled = false;
+static Stats::Format gFormat = Stats::Text;
+static QElapsedTimer gClock;
+
+static QAtomicInteger<qint64> gFilesOpened;
+static QAtomicInteger<qint64> gFilesSaved;
+static QAtomicInteger<qint64> gOpenFailures;
+static QAtomicInteger<qint64> gSaveFailures;
+static QAtomicInteger<qint64> gBytesRead;
+static QAtomicInteger<qint64> gBytesWritten;
+
+static Histogram gFileSizes;
+static Histogram gPhases[Stats::PhaseCount];
+
+static QAtomicInteger<int> gNextThread;
+static QMutex gTraceMutex;
+static QVector<TraceEvent> gTraceEvents;
+
+bool Stats::formatFromName(const QString &name, Format &format)
+{
+    for (int i = 0; i < int(sizeof(FormatNames) / sizeof(FormatNames[0])); ++i) {
+        if (name == FormatNames[i]) {
+            format = static_cast<Format>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+void Stats::enable(Format format)
+{
+    gFormat = format;
+    gClock.start();
+    gEnabled = true;
+}
+
+bool Stats::isEnabled()
+{
+    return gEnabled;
+}
+
+void Stats::fileOpened(qint64 size, bool success)
+{
+    if (!gEnabled) {
+        return;
+    }
+    if (success) {
+        gFilesOpened.fetchAndAddRelaxed(1);
+        gBytesRead.fetchAndAddRelaxed(size);
+        gFileSizes.add(size);
+    } else {
+        gOpenFailures.fetchAndAddRelaxed(1);
+    }
+}
+
+void Stats::fileSaved(qint64 size, bool success)
+{
+    if (!gEnabled) {
+        return;
+    }
+    if (success) {
+        gFilesSaved.fetchAndAddRelaxed(1);
+        gBytesWritten.fetchAndAddRelaxed(size);
+    } else {
+        gSaveFailures.fetchAndAddRelaxed(1);
+    }
+}
+
+void Stats::phaseFinished(Phase phase, qint64 start, qint64 duration)
+{
+    if (!gEnabled) {
+        return;
+    }
+    gPhases[phase].add(duration);
+
+    if (gFormat == Trace) {
+        static thread_local int thread = gNextThread.fetchAndAddRelaxed(1);
+        QMutexLocker locker(&gTraceMutex);
+        gTraceEvents.append(TraceEvent{phase, thread, start, duration});
+    }
+}
+
+qint64 Stats::now()
+{
+    return gEnabled ? gClock.nsecsElapsed() : 0;
+}
+
+static void appendTextBuckets(QByteArray &output, const Histogram &h)
+{
+    for (int i = 0; i < HistogramBuckets; ++i) {
+        qint64 count = h.buckets[i].load();
+        if (count) {
+            output.append(QString("< %1 %2\n").arg(1LL << i, -16).arg(count, 9));
+        }
+    }
+}
+
+static QByteArray dumpText()
+{
+    QByteArray output;
+
+    output.append(QString("files opened:  %1 (%2 failed)\n").arg(gFilesOpened.load()).arg(gOpenFailures.load()));
+    output.append(QString("files saved:   %1 (%2 failed)\n").arg(gFilesSaved.load()).arg(gSaveFailures.load()));
+    output.append(QString("bytes read:    %1\n").arg(gBytesRead.load()));
+    output.append(QString("bytes written: %1\n").arg(gBytesWritten.load()));
+
+    output.append("\nphase          count    total ms     mean ms\n");
+    for (int i = 0; i < Stats::PhaseCount; ++i) {
+        const Histogram &h = gPhases[i];
+        qint64 count = h.count.load();
+        double total = h.sum.load() / 1e6;
+        output.append(
+            QString("%1 %2 %3 %4\n")
+                .arg(PhaseNames[i], -12)
+                .arg(count, 7)
+                .arg(total, 11, 'f', 3)
+                .arg(count ? total / count : 0.0, 11, 'f', 3)
+        );
+    }
+
+    output.append("\nfile size (bytes)     count\n");
+    appendTextBuckets(output, gFileSizes);
+
+    // Only phases that ran are listed to keep the output short
+    for (int i = 0; i < Stats::PhaseCount; ++i) {
+        if (gPhases[i].count.load()) {
+            output.append(QString("\n%1 (ns) count\n").arg(PhaseNames[i], -16));
+            appendTextBuckets(output, gPhases[i]);
+        }
+    }
+
+    return output;
+}
+
+static void appendPrometheusHistogram(QByteArray &output, const QString &name, const QString &labels, const Histogram &h, double scale)
+{
+    QString prefix = labels.isEmpty() ? QString("{") : QString("{%1,").arg(labels);
+    qint64 cumulative = 0;
+    for (int i = 0; i < HistogramBuckets; ++i) {
+        cumulative += h.buckets[i].load();
+        output.append(QString("%1_bucket%2le=\"%3\"} %4\n").arg(name).arg(prefix).arg((1LL << i) * scale).arg(cumulative));
+    }
+    output.append(QString("%1_bucket%2le=\"+Inf\"} %3\n").arg(name).arg(prefix).arg(h.count.load()));
+
+    QString suffix = labels.isEmpty() ? QString() : QString("{%1}").arg(labels);
+    output.append(QString("%1_sum%2 %3\n").arg(name).arg(suffix).arg(h.sum.load() * scale));
+    output.append(QString("%1_count%2 %3\n").arg(name).arg(suffix).arg(h.count.load()));
+}
+
+static QByteArray dumpPrometheus()
+{
+    QByteArray output;
+
+    output.append("# TYPE esee_files_opened_total counter\n");
+    output.append(QString("esee_files_opened_total %1\n").arg(gFilesOpened.load()));
+    output.append("# TYPE esee_files_saved_total counter\n");
+    output.append(QString("esee_files_saved_total %1\n").arg(gFilesSaved.load()));
+    output.append("# TYPE esee_open_failures_total counter\n");
+    output.append(QString("esee_open_failures_total %1\n").arg(gOpenFailures.load()));
+    output.append("# TYPE esee_save_failures_total counter\n");
+    output.append(QString("esee_save_failures_total %1\n").arg(gSaveFailures.load()));
+    output.append("# TYPE esee_read_bytes_total counter\n");
+    output.append(QString("esee_read_bytes_total %1\n").arg(gBytesRead.load()));
+    output.append("# TYPE esee_written_bytes_total counter\n");
+    output.append(QString("esee_written_bytes_total %1\n").arg(gBytesWritten.load()));
+
+    output.append("# TYPE esee_file_size_bytes histogram\n");
+    appendPrometheusHistogram(output, "esee_file_size_bytes", QString(), gFileSizes, 1);
+
+    output.append("# TYPE esee_phase_duration_seconds histogram\n");
+    for (int i = 0; i < Stats::PhaseCount; ++i) {
+        appendPrometheusHistogram(
+            output,
+            "esee_phase_duration_seconds",
+            QString("phase=\"%1\"").arg(PhaseNames[i]),
+            gPhases[i],
+            1e-9
+        );
+    }
+
+    return output;
+}
+
+static QByteArray dumpTrace()
+{
+    QMutexLocker locker(&gTraceMutex);
+
+    // Timestamps in the Chrome trace event format are in microseconds
+    QJsonArray events;
+    foreach (const TraceEvent &event, gTraceEvents) {
+        QJsonObject object;
+        object.insert("name", PhaseNames[event.phase]);
+        object.insert("ph", "X");
+        object.insert("ts", event.start / 1e3);
+        object.insert("dur", event.duration / 1e3);
+        object.insert("pid", 1);
+        object.insert("tid", event.thread);
+        events.append(object);
+    }
+
+    QJsonObject trace;
+    trace.insert("traceEvents", events);
+    return QJsonDocument(trace).toJson(QJsonDocument::Compact);
+}
+
+QByteArray Stats::dump()
+{
+    switch (gFormat) {
+    case Prometheus:
+        return dumpPrometheus();
+    case Trace:
+        return dumpTrace();
+    default:
+        return dumpText();
+    }
+}
+
+StatsTimer::StatsTimer(Stats::Phase phase)
+    : mPhase(phase),
+      mStart(Stats::now())
+{
+}
+
+StatsTimer::~StatsTimer()
+{
+    if (gEnabled) {
+        Stats::phaseFinished(mPhase, mStart, Stats::now() - mStart);
+    }
+}
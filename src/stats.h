@@ -0,0 +1,91 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <QByteArray>
+#include <QString>
+
+/**
+ * @brief Low-overhead counters and timers for the hot paths
+ *
+ * Collection is disabled by default, in which case each call returns after
+ * checking a single flag. Once enabled, counters and histograms are updated
+ * atomically so that they can be shared by worker threads. Individual trace
+ * events are only retained when the Chrome trace format is requested.
+ */
+class Stats
+{
+public:
+
+    enum Phase {
+        Read,
+        Parse,
+        ExifParse,
+        Serialize,
+        Write,
+        Hash,
+        WidgetRead,
+        WidgetWrite,
+        PhaseCount
+    };
+
+    enum Format {
+        Text,
+        Prometheus,
+        Trace
+    };
+
+    static bool formatFromName(const QString &name, Format &format);
+
+    static void enable(Format format);
+    static bool isEnabled();
+
+    static void fileOpened(qint64 size, bool success);
+    static void fileSaved(qint64 size, bool success);
+    static void phaseFinished(Phase phase, qint64 start, qint64 duration);
+
+    static qint64 now();
+
+    static QByteArray dump();
+};
+
+/**
+ * @brief Record the duration of a phase for the lifetime of the instance
+ */
+class StatsTimer
+{
+public:
+
+    explicit StatsTimer(Stats::Phase phase);
+    ~StatsTimer();
+
+private:
+
+    Stats::Phase mPhase;
+    qint64 mStart;
+};
+
+#endif // STATS_H
@@ -40,6 +40,8 @@ public:
 
     StringTagWidget(ExifIfd ifd, const QString &name, QWidget *parent = nullptr);
 
+    virtual bool isModified() const;
+
 protected:
 
     virtual void reset();
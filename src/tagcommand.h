@@ -0,0 +1,61 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef TAGCOMMAND_H
+#define TAGCOMMAND_H
+
+#include <libexif/exif-data.h>
+
+#include <QUndoCommand>
+
+#include "exifutils.h"
+
+class AbstractTagWidget;
+
+/**
+ * @brief Undoable change to a single tag
+ *
+ * Rather than taking a copy of the ExifData instance, only the old and new
+ * values of the tag are stored.
+ */
+class TagCommand : public QUndoCommand
+{
+public:
+
+    TagCommand(ExifData *data, AbstractTagWidget *widget, const TagValue &oldValue, const TagValue &newValue);
+
+    virtual void undo();
+    virtual void redo();
+
+private:
+
+    void apply(const TagValue &value);
+
+    ExifData *mData;
+    AbstractTagWidget *mWidget;
+    TagValue mOldValue;
+    TagValue mNewValue;
+};
+
+#endif // TAGCOMMAND_H
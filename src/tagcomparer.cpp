@@ -0,0 +1,209 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+
+#include <libexif/exif-content.h>
+#include <libexif/exif-entry.h>
+#include <libexif/exif-format.h>
+#include <libexif/exif-utils.h>
+
+#include <QAtomicInt>
+
+#include "filelist.h"
+#include "jpegfile.h"
+#include "tagcomparer.h"
+
+bool TagComparer::loadReference(const QString &filename)
+{
+    JpegFile file(filename);
+    if (!file.open()) {
+        qWarning("unable to read %s", qPrintable(filename));
+        return false;
+    }
+    mReference = entries(file.data());
+    return true;
+}
+
+bool TagComparer::setSyncTags(const QString &names)
+{
+    mSyncTags.clear();
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+    QStringList list = names.split(',', Qt::SkipEmptyParts);
+#else
+    QStringList list = names.split(',', QString::SkipEmptyParts);
+#endif
+    foreach (const QString &name, list) {
+        ExifIfd ifd;
+        ExifTag tag;
+        if (!ExifUtils::findTag(name.trimmed(), ifd, tag)) {
+            qWarning("unknown tag \"%s\"", qPrintable(name.trimmed()));
+            return false;
+        }
+        mSyncTags.append(Key(ifd, tag));
+    }
+    return !mSyncTags.isEmpty();
+}
+
+int TagComparer::diff(const QStringList &filenames)
+{
+    // Files that differ count towards the result along with those that
+    // could not be read
+    QAtomicInt different;
+    int failed = FileList::process(
+        filenames,
+        [this, &different](const QString &filename, QString &output) -> bool {
+            QStringList differences;
+            if (!diffFile(filename, differences)) {
+                return false;
+            }
+            foreach (const QString &difference, differences) {
+                output.append(QString("%1: %2\n").arg(filename).arg(difference));
+            }
+            if (!differences.isEmpty()) {
+                different.ref();
+            }
+            return true;
+        },
+        "unable to read"
+    );
+
+    return failed + different.load();
+}
+
+int TagComparer::sync(const QStringList &filenames)
+{
+    return FileList::process(
+        filenames,
+        [this](const QString &filename, QString &) {
+            return syncFile(filename);
+        },
+        "unable to update"
+    );
+}
+
+bool TagComparer::diffFile(const QString &filename, QStringList &differences) const
+{
+    JpegFile file(filename);
+    if (!file.open()) {
+        return false;
+    }
+    QMap<Key, Entry> target = entries(file.data());
+
+    // Build a sorted list of the tags present in either file
+    QList<Key> keys = mReference.keys();
+    foreach (const Key &key, target.keys()) {
+        if (!mReference.contains(key)) {
+            keys.append(key);
+        }
+    }
+    std::sort(keys.begin(), keys.end());
+
+    foreach (const Key &key, keys) {
+        Entry reference = mReference.value(key);
+        Entry entry = target.value(key);
+        if (reference.value != entry.value) {
+            differences.append(
+                QString("%1: %2 -> %3")
+                    .arg(keyName(key))
+                    .arg(reference.value.present ? QString("\"%1\"").arg(reference.text) : QString("(none)"))
+                    .arg(entry.value.present ? QString("\"%1\"").arg(entry.text) : QString("(none)"))
+            );
+        }
+    }
+
+    return true;
+}
+
+bool TagComparer::syncFile(const QString &filename) const
+{
+    JpegFile file(filename);
+    if (!file.open()) {
+        return false;
+    }
+
+    ExifData *data = file.data();
+    ExifByteOrder order = exif_data_get_byte_order(data);
+
+    // Tags missing from the reference are removed from the target
+    foreach (const Key &key, mSyncTags) {
+        TagValue value = mReference.value(key).value;
+        convertByteOrder(value, EXIF_BYTE_ORDER_MOTOROLA, order);
+        if (!ExifUtils::setTagValue(data, static_cast<ExifIfd>(key.first), static_cast<ExifTag>(key.second), value)) {
+            return false;
+        }
+    }
+
+    return file.save();
+}
+
+QMap<TagComparer::Key, TagComparer::Entry> TagComparer::entries(ExifData *data)
+{
+    QMap<Key, Entry> entries;
+    ExifByteOrder order = exif_data_get_byte_order(data);
+
+    for (int i = 0; i < EXIF_IFD_COUNT; ++i) {
+        ExifContent *content = data->ifd[i];
+        for (unsigned int j = 0; j < content->count; ++j) {
+            ExifEntry *exifEntry = content->entries[j];
+
+            Entry entry;
+            entry.value = ExifUtils::tagValue(data, static_cast<ExifIfd>(i), exifEntry->tag);
+            convertByteOrder(entry.value, order, EXIF_BYTE_ORDER_MOTOROLA);
+
+            char text[256];
+            exif_entry_get_value(exifEntry, text, sizeof(text) / sizeof(char));
+            entry.text = QString::fromUtf8(text);
+
+            entries.insert(Key(i, exifEntry->tag), entry);
+        }
+    }
+
+    return entries;
+}
+
+void TagComparer::convertByteOrder(TagValue &value, ExifByteOrder from, ExifByteOrder to)
+{
+    // Skip values too short for the number of components they claim to have
+    if (!value.present || from == to ||
+            static_cast<unsigned long>(value.bytes.length()) < value.components * exif_format_get_size(value.format)) {
+        return;
+    }
+    exif_array_set_byte_order(
+        value.format,
+        reinterpret_cast<unsigned char*>(value.bytes.data()),
+        value.components,
+        from,
+        to
+    );
+}
+
+QString TagComparer::keyName(const Key &key)
+{
+    ExifIfd ifd = static_cast<ExifIfd>(key.first);
+    const char *name = exif_tag_get_name_in_ifd(static_cast<ExifTag>(key.second), ifd);
+    return QString("%1/%2")
+        .arg(exif_ifd_get_name(ifd))
+        .arg(name ? QString(name) : QString("0x%1").arg(key.second, 4, 16, QChar('0')));
+}
@@ -0,0 +1,76 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef TAGCOMPARER_H
+#define TAGCOMPARER_H
+
+#include <libexif/exif-data.h>
+
+#include <QList>
+#include <QMap>
+#include <QPair>
+#include <QStringList>
+
+#include "exifutils.h"
+
+/**
+ * @brief Compare or synchronize tags against a reference file
+ *
+ * Tags are addressed by (IFD, tag) pairs in the same way as
+ * AbstractTagWidget. The reference is decoded once and its values stored in
+ * big-endian byte order so that they can be compared with (and copied to)
+ * files using either byte order. Target files are processed in parallel.
+ */
+class TagComparer
+{
+public:
+
+    bool loadReference(const QString &filename);
+    bool setSyncTags(const QString &names);
+
+    int diff(const QStringList &filenames);
+    int sync(const QStringList &filenames);
+
+private:
+
+    typedef QPair<int, int> Key;
+
+    struct Entry
+    {
+        TagValue value;
+        QString text;
+    };
+
+    bool diffFile(const QString &filename, QStringList &differences) const;
+    bool syncFile(const QString &filename) const;
+
+    static QMap<Key, Entry> entries(ExifData *data);
+    static void convertByteOrder(TagValue &value, ExifByteOrder from, ExifByteOrder to);
+    static QString keyName(const Key &key);
+
+    QMap<Key, Entry> mReference;
+    QList<Key> mSyncTags;
+};
+
+#endif // TAGCOMPARER_H
@@ -0,0 +1,231 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QStringList>
+#include <QTextStream>
+
+#include "exifutils.h"
+#include "filelist.h"
+#include "jpegfile.h"
+#include "tagimporter.h"
+#include "thumbnailgenerator.h"
+
+TagImporter::TagImporter()
+    : mRegenerateThumbnails(false)
+{
+}
+
+void TagImporter::setRegenerateThumbnails(bool regenerateThumbnails)
+{
+    mRegenerateThumbnails = regenerateThumbnails;
+}
+
+bool TagImporter::load(const QString &filename)
+{
+    // Relative paths in the manifest are resolved against its directory
+    QString path = QFileInfo(filename).absolutePath();
+
+    QString suffix = QFileInfo(filename).suffix().toLower();
+    if (suffix == "json" || suffix == "jsonl" || suffix == "ndjson") {
+        return loadNdjson(filename, path);
+    } else {
+        return loadCsv(filename, path);
+    }
+}
+
+int TagImporter::apply()
+{
+    // Each file is opened and saved once with all of its edits
+    return FileList::process(
+        mEdits.keys(),
+        [this](const QString &filename, QString &) {
+            return applyEdits(filename, mEdits.value(filename), mRegenerateThumbnails);
+        },
+        "unable to update"
+    );
+}
+
+bool TagImporter::loadCsv(const QString &filename, const QString &path)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return false;
+    }
+
+    QTextStream stream(&file);
+    stream.setCodec("UTF-8");
+
+    for (int lineNumber = 1; !stream.atEnd(); ++lineNumber) {
+        QString line = stream.readLine();
+        if (line.trimmed().isEmpty()) {
+            continue;
+        }
+
+        QStringList columns = parseCsvLine(line);
+        if (columns.count() != 3) {
+            qWarning("%s:%d: expected 3 columns", qPrintable(filename), lineNumber);
+            return false;
+        }
+
+        // Skip the optional header row
+        if (lineNumber == 1 && columns.at(0) == "path" && columns.at(1) == "tag") {
+            continue;
+        }
+
+        // CSV cannot distinguish an empty string from a missing value, so an
+        // empty value removes the tag
+        QString location = QString("%1:%2").arg(filename).arg(lineNumber);
+        if (!addEdit(location, path, columns.at(0), columns.at(1), columns.at(2), columns.at(2).isEmpty())) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool TagImporter::loadNdjson(const QString &filename, const QString &path)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    for (int lineNumber = 1; !file.atEnd(); ++lineNumber) {
+        QByteArray line = file.readLine().trimmed();
+        if (line.isEmpty()) {
+            continue;
+        }
+
+        QJsonDocument document = QJsonDocument::fromJson(line);
+        if (!document.isObject()) {
+            qWarning("%s:%d: expected an object", qPrintable(filename), lineNumber);
+            return false;
+        }
+
+        QJsonObject object = document.object();
+        QString location = QString("%1:%2").arg(filename).arg(lineNumber);
+
+        // Values must be strings (which are converted to the tag's format)
+        // or null to remove the tag
+        QJsonValue value = object.value("value");
+        if (!value.isString() && !value.isNull()) {
+            qWarning("%s: expected a string or null value", qPrintable(location));
+            return false;
+        }
+
+        if (!addEdit(location, path, object.value("path").toString(),
+                     object.value("tag").toString(), value.toString(), value.isNull())) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool TagImporter::addEdit(const QString &location, const QString &path, const QString &filename,
+                          const QString &name, const QString &value, bool remove)
+{
+    Edit edit;
+    if (!ExifUtils::findTag(name, edit.ifd, edit.tag)) {
+        qWarning("%s: unknown tag \"%s\"", qPrintable(location), qPrintable(name));
+        return false;
+    }
+
+    // Reject values that cannot be converted to the tag's format up front
+    // rather than failing halfway through the batch
+    TagValue tagValue;
+    if (!remove && !ExifUtils::fromString(edit.ifd, edit.tag, value, EXIF_BYTE_ORDER_MOTOROLA, tagValue)) {
+        qWarning("%s: invalid value for \"%s\"", qPrintable(location), qPrintable(name));
+        return false;
+    }
+    edit.value = value.toUtf8();
+    edit.remove = remove;
+
+    // Later rows for the same file are applied after earlier ones, so the
+    // last value in the manifest wins
+    mEdits[QDir::cleanPath(QDir(path).absoluteFilePath(filename))].append(edit);
+
+    return true;
+}
+
+QStringList TagImporter::parseCsvLine(const QString &line)
+{
+    QStringList columns;
+    QString column;
+    bool quoted = false;
+
+    for (int i = 0; i < line.length(); ++i) {
+        QChar c = line.at(i);
+        if (quoted) {
+            if (c == '"') {
+                if (i + 1 < line.length() && line.at(i + 1) == '"') {
+                    column.append(c);
+                    ++i;
+                } else {
+                    quoted = false;
+                }
+            } else {
+                column.append(c);
+            }
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == ',') {
+            columns.append(column);
+            column.clear();
+        } else {
+            column.append(c);
+        }
+    }
+    columns.append(column);
+
+    return columns;
+}
+
+bool TagImporter::applyEdits(const QString &filename, const QList<Edit> &edits, bool regenerateThumbnail)
+{
+    JpegFile file(filename);
+    if (!file.open()) {
+        return false;
+    }
+
+    foreach (const Edit &edit, edits) {
+        if (edit.remove) {
+            ExifUtils::removeEntry(file.data(), edit.ifd, edit.tag);
+        } else if (!ExifUtils::setStringValue(file.data(), edit.ifd, edit.tag, edit.value)) {
+            return false;
+        }
+    }
+
+    if (regenerateThumbnail && !ThumbnailGenerator::regenerate(file)) {
+        return false;
+    }
+
+    return file.save();
+}
@@ -0,0 +1,78 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef TAGIMPORTER_H
+#define TAGIMPORTER_H
+
+#include <libexif/exif-ifd.h>
+#include <libexif/exif-tag.h>
+
+#include <QByteArray>
+#include <QList>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+
+/**
+ * @brief Bulk import of tag values from a manifest
+ *
+ * Manifests are either CSV or NDJSON files consisting of (path, tag, value)
+ * rows. Tags are removed by an empty CSV value or a null JSON value. Edits
+ * are grouped by file so that each file is opened and saved exactly once,
+ * with the files themselves processed in parallel.
+ */
+class TagImporter
+{
+public:
+
+    TagImporter();
+
+    void setRegenerateThumbnails(bool regenerateThumbnails);
+
+    bool load(const QString &filename);
+    int apply();
+
+private:
+
+    struct Edit
+    {
+        ExifIfd ifd;
+        ExifTag tag;
+        QByteArray value;
+        bool remove;
+    };
+
+    bool loadCsv(const QString &filename, const QString &path);
+    bool loadNdjson(const QString &filename, const QString &path);
+    bool addEdit(const QString &location, const QString &path, const QString &filename,
+                 const QString &name, const QString &value, bool remove);
+
+    static QStringList parseCsvLine(const QString &line);
+    static bool applyEdits(const QString &filename, const QList<Edit> &edits, bool regenerateThumbnail);
+
+    QMap<QString, QList<Edit> > mEdits;
+    bool mRegenerateThumbnails;
+};
+
+#endif // TAGIMPORTER_H
@@ -0,0 +1,171 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <cstdlib>
+#include <cstring>
+
+#include <libexif/exif-mem.h>
+
+#include <QBuffer>
+#include <QImage>
+#include <QImageReader>
+
+#include "exifutils.h"
+#include "filelist.h"
+#include "jpegfile.h"
+#include "thumbnailgenerator.h"
+
+// Dimensions recommended by the EXIF specification
+const int ThumbnailWidth = 160;
+const int ThumbnailHeight = 120;
+
+// Largest EXIF payload that fits in an APP1 segment (the 16-bit size
+// includes the two bytes used to store it)
+const int MaxExifSize = 0xffff - 2;
+
+// Space used by the JPEGInterchangeFormat and JPEGInterchangeFormatLength
+// entries that libexif adds to IFD1 when a thumbnail is present
+const int ThumbnailOverhead = 32;
+
+// Qualities to try (in order) when encoding the thumbnail
+const int Qualities[] = { 90, 75, 60, 45, 30 };
+
+bool ThumbnailGenerator::regenerate(JpegFile &file)
+{
+    ExifData *data = file.data();
+
+    // Have libjpeg decode the image at (roughly) thumbnail size
+    QImageReader reader(file.filename(), "jpeg");
+    QSize size = reader.size();
+    if (!size.isValid()) {
+        return false;
+    }
+    if (size.width() > ThumbnailWidth || size.height() > ThumbnailHeight) {
+        reader.setScaledSize(size.scaled(ThumbnailWidth, ThumbnailHeight, Qt::KeepAspectRatio));
+    }
+    QImage image = reader.read();
+    if (image.isNull()) {
+        return false;
+    }
+
+    // Remove the stale thumbnail
+    ExifMem *mem = exif_mem_new_default();
+    if (!mem) {
+        return false;
+    }
+    if (data->data) {
+        exif_mem_free(mem, data->data);
+        data->data = nullptr;
+        data->size = 0;
+    }
+
+    // Remove any tags describing an uncompressed thumbnail and mark IFD1 as
+    // describing a JPEG thumbnail
+    const ExifTag staleTags[] = {
+        EXIF_TAG_IMAGE_WIDTH,
+        EXIF_TAG_IMAGE_LENGTH,
+        EXIF_TAG_STRIP_OFFSETS,
+        EXIF_TAG_STRIP_BYTE_COUNTS,
+        EXIF_TAG_ROWS_PER_STRIP
+    };
+    for (ExifTag tag : staleTags) {
+        ExifUtils::removeEntry(data, EXIF_IFD_1, tag);
+    }
+    if (!ExifUtils::setShortValue(data, EXIF_IFD_1, EXIF_TAG_COMPRESSION, 6)) {
+        exif_mem_unref(mem);
+        return false;
+    }
+
+    // Determine how much space remains for the thumbnail
+    int maxSize = MaxExifSize - static_cast<int>(exifSize(file)) - ThumbnailOverhead;
+
+    // Encode the thumbnail, reducing its size until it fits
+    QByteArray jpeg;
+    bool success = false;
+    while (maxSize > 0 && !image.isNull()) {
+        if (encode(image, maxSize, jpeg)) {
+            success = true;
+            break;
+        }
+        image = image.scaled(image.size() / 2, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+
+    // Hand the thumbnail to libexif, which writes it out with the IFD1 data
+    if (success) {
+        data->data = reinterpret_cast<unsigned char*>(exif_mem_alloc(mem, jpeg.length()));
+        if (data->data) {
+            memcpy(data->data, jpeg.constData(), jpeg.length());
+            data->size = jpeg.length();
+        } else {
+            success = false;
+        }
+    }
+
+    exif_mem_unref(mem);
+    return success;
+}
+
+int ThumbnailGenerator::regenerate(const QStringList &filenames)
+{
+    return FileList::process(
+        filenames,
+        [](const QString &filename, QString &) {
+            return regenerateFile(filename);
+        },
+        "unable to regenerate thumbnail for"
+    );
+}
+
+bool ThumbnailGenerator::regenerateFile(const QString &filename)
+{
+    JpegFile file(filename);
+    return file.open() && regenerate(file) && file.save();
+}
+
+bool ThumbnailGenerator::encode(const QImage &image, int maxSize, QByteArray &jpeg)
+{
+    for (int quality : Qualities) {
+        jpeg.clear();
+        QBuffer buffer(&jpeg);
+        buffer.open(QIODevice::WriteOnly);
+        if (!image.save(&buffer, "jpeg", quality)) {
+            return false;
+        }
+        if (jpeg.length() <= maxSize) {
+            return true;
+        }
+    }
+    return false;
+}
+
+unsigned int ThumbnailGenerator::exifSize(JpegFile &file)
+{
+    unsigned char *data;
+    unsigned int dataSize = 0;
+    exif_data_save_data(file.data(), &data, &dataSize);
+    if (dataSize) {
+        free(data);
+    }
+    return dataSize;
+}
@@ -0,0 +1,57 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef THUMBNAILGENERATOR_H
+#define THUMBNAILGENERATOR_H
+
+#include <QByteArray>
+#include <QStringList>
+
+class QImage;
+
+class JpegFile;
+
+/**
+ * @brief Regenerate the embedded (IFD1) thumbnail from the main image
+ *
+ * The main image is decoded at reduced size so that libjpeg can perform most
+ * of the downscaling in the DCT domain. The thumbnail is then re-encoded at
+ * decreasing quality (and if necessary, size) until the EXIF segment fits
+ * within the 64 KB limit of a JPEG segment.
+ */
+class ThumbnailGenerator
+{
+public:
+
+    static bool regenerate(JpegFile &file);
+    static int regenerate(const QStringList &filenames);
+
+private:
+
+    static bool regenerateFile(const QString &filename);
+    static bool encode(const QImage &image, int maxSize, QByteArray &jpeg);
+    static unsigned int exifSize(JpegFile &file);
+};
+
+#endif // THUMBNAILGENERATOR_H